@@ -23,6 +23,7 @@
 #include <benchmark/benchmark.h>
 
 #include "bench-main.hpp"
+#include "tests/fpsemi-examples.hpp"
 #include "todd-coxeter.hpp"
 
 using congruence_type              = libsemigroups::congruence_type;
@@ -55,6 +56,96 @@ void BM_todd_coxeter_002(benchmark::State& st) {
   // S.nr_idempotents();
 }
 
+// The next two benchmarks are for presentations where HLT kills many cosets,
+// and so the time spent processing coincidences is significant.
+void BM_todd_coxeter_RennerTypeBMonoid_4_0(benchmark::State& st) {
+  using ToddCoxeter = libsemigroups::fpsemigroup::ToddCoxeter;
+  using policy      = libsemigroups::congruence::ToddCoxeter::policy;
+  auto rg           = libsemigroups::ReportGuard(false);
+  for (auto _ : st) {
+    ToddCoxeter tc;
+    tc.set_alphabet(10);
+    for (auto const& rl : libsemigroups::RennerTypeBMonoid(4, 0)) {
+      tc.add_rule(rl);
+    }
+    tc.congruence()
+        .strategy(policy::strategy::hlt)
+        .lookahead(policy::lookahead::full)
+        .next_lookahead(100000);
+    benchmark::DoNotOptimize(tc.size());
+  }
+}
+
+void BM_todd_coxeter_RennerTypeDMonoid_4_0(benchmark::State& st) {
+  using ToddCoxeter = libsemigroups::fpsemigroup::ToddCoxeter;
+  using policy      = libsemigroups::congruence::ToddCoxeter::policy;
+  auto rg           = libsemigroups::ReportGuard(false);
+  for (auto _ : st) {
+    ToddCoxeter tc;
+    tc.set_alphabet(11);
+    for (auto const& rl : libsemigroups::RennerTypeDMonoid(4, 0)) {
+      tc.add_rule(rl);
+    }
+    tc.congruence()
+        .strategy(policy::strategy::hlt)
+        .lookahead(policy::lookahead::full)
+        .next_lookahead(100000);
+    benchmark::DoNotOptimize(tc.size());
+  }
+}
+
+// The next benchmark compares storing the coset tables in memory (argument
+// 0) with storing them in files in the current directory (argument 1), see
+// ToddCoxeter::table_directory.
+void BM_todd_coxeter_RennerTypeDMonoid_4_1_table_directory(
+    benchmark::State& st) {
+  using ToddCoxeter = libsemigroups::fpsemigroup::ToddCoxeter;
+  using policy      = libsemigroups::congruence::ToddCoxeter::policy;
+  auto rg           = libsemigroups::ReportGuard(false);
+  for (auto _ : st) {
+    ToddCoxeter tc;
+    tc.set_alphabet(11);
+    for (auto const& rl : libsemigroups::RennerTypeDMonoid(4, 1)) {
+      tc.add_rule(rl);
+    }
+    tc.congruence()
+        .strategy(policy::strategy::hlt)
+        .table_directory(st.range(0) == 0 ? "" : ".");
+    benchmark::DoNotOptimize(tc.size());
+  }
+}
+
+// The next benchmark compares the HLT strategy (argument 0) with the
+// portfolio strategy (argument 1), on as many threads as are available, see
+// ToddCoxeter::policy::strategy::portfolio.
+void BM_todd_coxeter_RennerTypeDMonoid_4_1_portfolio(benchmark::State& st) {
+  using ToddCoxeter = libsemigroups::fpsemigroup::ToddCoxeter;
+  using policy      = libsemigroups::congruence::ToddCoxeter::policy;
+  auto rg           = libsemigroups::ReportGuard(false);
+  for (auto _ : st) {
+    ToddCoxeter tc;
+    tc.set_alphabet(11);
+    for (auto const& rl : libsemigroups::RennerTypeDMonoid(4, 1)) {
+      tc.add_rule(rl);
+    }
+    tc.congruence().strategy(st.range(0) == 0 ? policy::strategy::hlt
+                                              : policy::strategy::portfolio);
+    benchmark::DoNotOptimize(tc.size());
+  }
+}
+
 BENCHMARK_MAIN();
 
 BENCHMARK(BM_todd_coxeter_002)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_todd_coxeter_RennerTypeBMonoid_4_0)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_todd_coxeter_RennerTypeDMonoid_4_0)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_todd_coxeter_RennerTypeDMonoid_4_1_table_directory)
+    ->Arg(0)
+    ->Arg(1)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_todd_coxeter_RennerTypeDMonoid_4_1_portfolio)
+    ->Arg(0)
+    ->Arg(1)
+    ->Unit(benchmark::kMillisecond);
@@ -0,0 +1,8 @@
+#!/bin/bash
+set -e
+
+# Setup
+ci/travis-setup.sh
+
+./configure --enable-compact-index
+make test_all -j2 && ./test_all "[quick]"
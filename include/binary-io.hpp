@@ -0,0 +1,340 @@
+//
+// libsemigroups - C++ library for semigroups and monoids
+// Copyright (C) 2019 James D. Mitchell
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+// This file contains some functions for writing and reading the data
+// structures used by libsemigroups to and from binary files, for use in
+// checkpointing. The files are not portable between platforms with different
+// endianness or type sizes.
+
+#ifndef LIBSEMIGROUPS_INCLUDE_BINARY_IO_HPP_
+#define LIBSEMIGROUPS_INCLUDE_BINARY_IO_HPP_
+
+#include <algorithm>    // for copy, max, min
+#include <cstddef>      // for size_t
+#include <cstdint>      // for uint8_t, uint64_t
+#include <fstream>      // for fstream
+#include <istream>      // for istream
+#include <ostream>      // for ostream
+#include <string>       // for string
+#include <type_traits>  // for is_trivially_copyable
+#include <utility>      // for pair
+#include <vector>       // for vector
+
+#include "containers.hpp"               // for BitArray2, DynamicArray2
+#include "libsemigroups-exception.hpp"  // for LIBSEMIGROUPS_EXCEPTION
+
+namespace libsemigroups {
+  namespace detail {
+    // The lengths read from a file are not trusted, and so containers are
+    // grown by at most this many bytes before the data that fills them is
+    // read. A corrupt length then results in "unexpected end of file" rather
+    // than an attempt to allocate an enormous amount of memory.
+    constexpr size_t BINARY_IO_CHUNK_BYTES = size_t(1) << 20;
+
+    template <typename T>
+    void write_binary(std::ostream& os, T const& x) {
+      static_assert(std::is_trivially_copyable<T>::value,
+                    "the template parameter T must be trivially copyable");
+      os.write(reinterpret_cast<char const*>(&x), sizeof(T));
+    }
+
+    template <typename T>
+    void read_binary(std::istream& is, T& x) {
+      static_assert(std::is_trivially_copyable<T>::value,
+                    "the template parameter T must be trivially copyable");
+      if (!is.read(reinterpret_cast<char*>(&x), sizeof(T))) {
+        LIBSEMIGROUPS_EXCEPTION("unexpected end of file");
+      }
+    }
+
+    // A bool is written as a single byte, and any value of that byte other
+    // than 0 or 1 is rejected, since it is not a valid bool.
+    inline void read_binary(std::istream& is, bool& x) {
+      static_assert(sizeof(bool) == 1, "expected bool to be a single byte");
+      uint8_t b;
+      read_binary(is, b);
+      if (b > 1) {
+        LIBSEMIGROUPS_EXCEPTION("expected a bool, found %d", b);
+      }
+      x = (b == 1);
+    }
+
+    template <typename T, typename A>
+    void write_binary(std::ostream& os, std::vector<T, A> const& vec) {
+      static_assert(std::is_trivially_copyable<T>::value,
+                    "the template parameter T must be trivially copyable");
+      write_binary(os, static_cast<uint64_t>(vec.size()));
+      os.write(reinterpret_cast<char const*>(vec.data()),
+               sizeof(T) * vec.size());
+    }
+
+    // Appends n values read from is to vec.
+    template <typename T, typename A>
+    void read_binary(std::istream& is, std::vector<T, A>& vec, uint64_t n) {
+      static_assert(std::is_trivially_copyable<T>::value,
+                    "the template parameter T must be trivially copyable");
+      size_t const chunk
+          = std::max(size_t(1), BINARY_IO_CHUNK_BYTES / sizeof(T));
+      while (n != 0) {
+        size_t const i = vec.size();
+        size_t const k = static_cast<size_t>(std::min(uint64_t(chunk), n));
+        vec.resize(i + k);
+        if (!is.read(reinterpret_cast<char*>(vec.data() + i), sizeof(T) * k)) {
+          LIBSEMIGROUPS_EXCEPTION("unexpected end of file");
+        }
+        n -= k;
+      }
+    }
+
+    template <typename T, typename A>
+    void read_binary(std::istream& is, std::vector<T, A>& vec) {
+      uint64_t n;
+      read_binary(is, n);
+      vec.clear();
+      read_binary(is, vec, n);
+    }
+
+    // std::vector<bool> is not contiguous, so it is written one byte per
+    // entry.
+    template <typename A>
+    void write_binary(std::ostream& os, std::vector<bool, A> const& vec) {
+      write_binary(os, std::vector<uint8_t>(vec.cbegin(), vec.cend()));
+    }
+
+    template <typename A>
+    void read_binary(std::istream& is, std::vector<bool, A>& vec) {
+      std::vector<uint8_t> tmp;
+      read_binary(is, tmp);
+      vec.assign(tmp.cbegin(), tmp.cend());
+    }
+
+    template <typename T, typename A>
+    void write_binary(std::ostream&                          os,
+                      std::vector<std::vector<T>, A> const& vec) {
+      write_binary(os, static_cast<uint64_t>(vec.size()));
+      for (auto const& x : vec) {
+        write_binary(os, x);
+      }
+    }
+
+    template <typename T, typename A>
+    void read_binary(std::istream& is, std::vector<std::vector<T>, A>& vec) {
+      uint64_t n;
+      read_binary(is, n);
+      vec.clear();
+      for (uint64_t i = 0; i < n; ++i) {
+        vec.emplace_back();
+        read_binary(is, vec.back());
+      }
+    }
+
+    template <typename S, typename T>
+    void write_binary(std::ostream&                       os,
+                      std::vector<std::pair<S, T>> const& vec) {
+      write_binary(os, static_cast<uint64_t>(vec.size()));
+      for (auto const& x : vec) {
+        write_binary(os, x.first);
+        write_binary(os, x.second);
+      }
+    }
+
+    template <typename S, typename T>
+    void read_binary(std::istream& is, std::vector<std::pair<S, T>>& vec) {
+      uint64_t n;
+      read_binary(is, n);
+      vec.clear();
+      for (uint64_t i = 0; i < n; ++i) {
+        S x;
+        T y;
+        read_binary(is, x);
+        read_binary(is, y);
+        vec.emplace_back(x, y);
+      }
+    }
+
+    // Only the used columns and rows of a DynamicArray2 are written, one row
+    // at a time. Entries of type bool are written as one byte each.
+    template <typename T, typename A>
+    void write_binary(std::ostream& os, DynamicArray2<T, A> const& da) {
+      using value_type =
+          typename std::conditional<std::is_same<T, bool>::value, uint8_t, T>::
+              type;
+      write_binary(os, static_cast<uint64_t>(da.nr_cols()));
+      write_binary(os, static_cast<uint64_t>(da.nr_rows()));
+      std::vector<value_type> row(da.nr_cols());
+      for (size_t i = 0; i < da.nr_rows(); ++i) {
+        for (size_t j = 0; j < da.nr_cols(); ++j) {
+          row[j] = da.get(i, j);
+        }
+        os.write(reinterpret_cast<char const*>(row.data()),
+                 sizeof(value_type) * row.size());
+      }
+    }
+
+    // The DynamicArray2 da must have the same number of columns as the one
+    // that was written, all of its rows are replaced by those that are read.
+    template <typename T, typename A>
+    void read_binary(std::istream& is, DynamicArray2<T, A>& da) {
+      using value_type =
+          typename std::conditional<std::is_same<T, bool>::value, uint8_t, T>::
+              type;
+      uint64_t nr_cols, nr_rows;
+      read_binary(is, nr_cols);
+      read_binary(is, nr_rows);
+      if (nr_cols != da.nr_cols()) {
+        LIBSEMIGROUPS_EXCEPTION("expected %d columns, found %d",
+                                da.nr_cols(),
+                                nr_cols);
+      }
+      size_t const chunk = std::max(
+          size_t(1),
+          BINARY_IO_CHUNK_BYTES / (sizeof(value_type) * (nr_cols + 1)));
+      da.shrink_rows_to(0);
+      std::vector<value_type> row(nr_cols);
+      for (size_t i = 0; i < nr_rows; ++i) {
+        if (i % chunk == 0) {
+          da.add_rows(
+              static_cast<size_t>(std::min(uint64_t(chunk), nr_rows - i)));
+        }
+        if (!is.read(reinterpret_cast<char*>(row.data()),
+                     sizeof(value_type) * row.size())) {
+          LIBSEMIGROUPS_EXCEPTION("unexpected end of file");
+        }
+        for (size_t j = 0; j < nr_cols; ++j) {
+          da.set(i, j, row[j]);
+        }
+      }
+    }
+
+    // Unsigned integers are written in a variable number of bytes, 7 bits per
+    // byte starting with the least significant, and the top bit of every
+    // byte except the last is set. Unlike the other functions in this file,
+    // the result does not depend on the endianness or type sizes of the
+    // platform.
+    inline void write_varint(std::ostream& os, uint64_t x) {
+      while (x >= 0x80) {
+        os.put(static_cast<char>((x & 0x7f) | 0x80));
+        x >>= 7;
+      }
+      os.put(static_cast<char>(x));
+    }
+
+    inline uint64_t read_varint(std::istream& is) {
+      uint64_t x = 0;
+      for (size_t shift = 0; shift < 64; shift += 7) {
+        int const c = is.get();
+        if (c == std::istream::traits_type::eof()) {
+          LIBSEMIGROUPS_EXCEPTION("unexpected end of file");
+        }
+        x |= static_cast<uint64_t>(c & 0x7f) << shift;
+        if ((c & 0x80) == 0) {
+          return x;
+        }
+      }
+      LIBSEMIGROUPS_EXCEPTION("invalid variable length integer");
+    }
+
+    // The blocks of a BitArray2 are written directly, the BitArray2 ba is
+    // resized to have the dimensions of the one that was written.
+    inline void write_binary(std::ostream& os, BitArray2 const& ba) {
+      write_binary(os, static_cast<uint64_t>(ba.nr_cols()));
+      write_binary(os, static_cast<uint64_t>(ba.nr_rows()));
+      if (ba.nr_rows() != 0) {
+        os.write(reinterpret_cast<char const*>(ba.row(0)),
+                 sizeof(BitArray2::block_type) * ba.nr_rows()
+                     * ba.nr_blocks_per_row());
+      }
+    }
+
+    // The blocks are read before ba is reset, so that ba is not resized
+    // according to dimensions that are not backed by data in the file.
+    inline void read_binary(std::istream& is, BitArray2& ba) {
+      using block_type = BitArray2::block_type;
+      size_t const bits = BitArray2::bits_per_block;
+      uint64_t     nr_cols, nr_rows;
+      read_binary(is, nr_cols);
+      read_binary(is, nr_rows);
+      uint64_t const nr_blocks_per_row = nr_cols / bits + (nr_cols % bits != 0);
+      if (nr_rows != 0 && nr_blocks_per_row > uint64_t(-1) / nr_rows) {
+        LIBSEMIGROUPS_EXCEPTION("invalid dimensions %d x %d", nr_rows, nr_cols);
+      }
+      std::vector<block_type> blocks;
+      read_binary(is, blocks, nr_rows * nr_blocks_per_row);
+      ba.reset(nr_cols, nr_rows);
+      if (!blocks.empty()) {
+        std::copy(blocks.cbegin(), blocks.cend(), ba.row(0));
+      }
+    }
+
+    // Checkpoint files end with a checksum of all of the preceding bytes, so
+    // that a corrupt file is detected before anything read from it is used.
+    // The checksum is the 64-bit FNV-1a hash of the bytes.
+    inline uint64_t checksum(std::istream& is, uint64_t n) {
+      uint64_t          h = 0xcbf29ce484222325;
+      std::vector<char> buf(
+          static_cast<size_t>(std::min(uint64_t(BINARY_IO_CHUNK_BYTES), n)));
+      while (n != 0) {
+        size_t const k = static_cast<size_t>(std::min(uint64_t(buf.size()), n));
+        if (!is.read(buf.data(), k)) {
+          LIBSEMIGROUPS_EXCEPTION("unexpected end of file");
+        }
+        for (size_t i = 0; i < k; ++i) {
+          h ^= static_cast<uint8_t>(buf[i]);
+          h *= 0x100000001b3;
+        }
+        n -= k;
+      }
+      return h;
+    }
+
+    // Appends the checksum of the contents of the file path to it.
+    inline void write_checksum(std::string const& path) {
+      std::fstream fs(path, std::ios::binary | std::ios::in | std::ios::out);
+      if (!fs.seekg(0, std::ios::end)) {
+        LIBSEMIGROUPS_EXCEPTION("cannot open %s", path);
+      }
+      uint64_t const n = static_cast<uint64_t>(fs.tellg());
+      fs.seekg(0);
+      uint64_t const h = checksum(fs, n);
+      fs.seekp(0, std::ios::end);
+      write_binary(fs, h);
+      if (!fs.flush()) {
+        LIBSEMIGROUPS_EXCEPTION("cannot write to %s", path);
+      }
+    }
+
+    // Returns true if the file read by is ends with the checksum written by
+    // write_checksum, and rewinds is to the start of the file.
+    inline bool valid_checksum(std::istream& is) {
+      if (!is.seekg(0, std::ios::end)) {
+        return false;
+      }
+      uint64_t const n = static_cast<uint64_t>(is.tellg());
+      if (n < sizeof(uint64_t)) {
+        return false;
+      }
+      is.seekg(0);
+      uint64_t const h = checksum(is, n - sizeof(uint64_t));
+      uint64_t       expected;
+      read_binary(is, expected);
+      is.seekg(0);
+      return h == expected;
+    }
+  }  // namespace detail
+}  // namespace libsemigroups
+#endif  // LIBSEMIGROUPS_INCLUDE_BINARY_IO_HPP_
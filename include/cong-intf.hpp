@@ -52,7 +52,7 @@ namespace libsemigroups {
     ////////////////////////////////////////////////////////////////////////////
 
     //! Type for indices of congruence class indices.
-    using class_index_type = size_t;
+    using class_index_type = table_index_type;
 
     //! Type for non-trivial classes.
     //! \sa cbegin_ntc and cend_ntc.
@@ -19,11 +19,19 @@
 #ifndef LIBSEMIGROUPS_INCLUDE_CONTAINERS_HPP_
 #define LIBSEMIGROUPS_INCLUDE_CONTAINERS_HPP_
 
-#include <array>     // for array
-#include <cstddef>   // for size_t
-#include <iterator>  // for reverse_iterator
-#include <vector>    // for vector, allocator
-
+#include <algorithm>    // for fill, min
+#include <array>        // for array
+#include <cstddef>      // for size_t
+#include <cstdint>      // for uint64_t, uintptr_t
+#include <iterator>     // for reverse_iterator
+#include <map>          // for map
+#include <memory>       // for unique_ptr
+#include <new>          // for placement new
+#include <type_traits>  // for is_trivially_copyable
+#include <utility>      // for forward, pair
+#include <vector>       // for vector, allocator
+
+#include "constants.hpp"            // for UNDEFINED
 #include "iterator.hpp"             // for ConstIteratorStateful, ConstItera...
 #include "libsemigroups-debug.hpp"  // for LIBSEMIGROUPS_ASSERT
 
@@ -67,6 +75,28 @@ namespace libsemigroups {
         this->add_rows(nr_rows);
       }
 
+      // Not noexcept because DynamicArray2::add_rows can throw.
+      DynamicArray2(size_t   nr_cols,
+                    size_t   nr_rows,
+                    T        default_val,
+                    A const& alloc)
+          : _vec(alloc),
+            _nr_used_cols(nr_cols),
+            _nr_unused_cols(0),
+            _nr_rows(0),
+            _default_val(default_val) {
+        this->add_rows(nr_rows);
+      }
+
+      // Not noexcept because std::vector::vector(std::vector const&, A const&)
+      // can throw.
+      DynamicArray2(DynamicArray2 const& copy, A const& alloc)
+          : _vec(copy._vec, alloc),
+            _nr_used_cols(copy._nr_used_cols),
+            _nr_unused_cols(copy._nr_unused_cols),
+            _nr_rows(copy._nr_rows),
+            _default_val(copy._default_val) {}
+
       // Not noexcept because DynamicArray2::DynamicArray2(size_t, size_t) can
       // throw.
       explicit DynamicArray2(std::initializer_list<std::initializer_list<T>> il)
@@ -137,6 +167,10 @@ namespace libsemigroups {
         return _vec.max_size();
       }
 
+      A get_allocator() const {
+        return _vec.get_allocator();
+      }
+
       // Not noexcept, since std::filll can throw
       void fill(T const& val) {
         std::fill(_vec.begin(), _vec.end(), val);
@@ -172,11 +206,12 @@ namespace libsemigroups {
       //             2. should perform checks that p actually permutes the
       //                given row
       // Not noexcept because std::vector::operator[] isn't
-      void apply_row_permutation(std::vector<size_t> p) {
-        for (size_t i = 0; i < p.size(); i++) {
-          size_t current = i;
+      template <typename S>
+      void apply_row_permutation(std::vector<S> p) {
+        for (S i = 0; i < p.size(); i++) {
+          S current = i;
           while (i != p[current]) {
-            size_t next = p[current];
+            S next = p[current];
             swap_rows(current, next);
             p[current] = current;
             current    = next;
@@ -238,9 +273,9 @@ namespace libsemigroups {
         if (_nr_rows != 0) {
           _vec.resize(new_nr_cols * _nr_rows, _default_val);
 
-          typename std::vector<T>::iterator old_it(
+          typename std::vector<T, A>::iterator old_it(
               _vec.begin() + (old_nr_cols * _nr_rows) - old_nr_cols);
-          typename std::vector<T>::iterator new_it(
+          typename std::vector<T, A>::iterator new_it(
               _vec.begin() + (new_nr_cols * _nr_rows) - new_nr_cols);
 
           while (old_it != _vec.begin()) {
@@ -610,6 +645,18 @@ namespace libsemigroups {
         return cbegin_row(row_index) + _nr_used_cols;
       }
 
+      // Hint that the row with index row_index will be read soon, so that it
+      // can be fetched into the cache while other work is done.
+      void prefetch_row(size_t row_index) const noexcept {
+        LIBSEMIGROUPS_ASSERT(row_index < _nr_rows);
+#if defined(__GNUC__)
+        __builtin_prefetch(_vec.data()
+                           + (_nr_used_cols + _nr_unused_cols) * row_index);
+#else
+        (void) row_index;
+#endif
+      }
+
       const_column_iterator cbegin_column(size_t col_index) const noexcept {
         LIBSEMIGROUPS_ASSERT(col_index < _nr_used_cols);
         return const_column_iterator(this, _vec.begin() + col_index);
@@ -766,6 +813,465 @@ namespace libsemigroups {
      private:
       std::array<std::array<T, N>, N> _arrays;
     };
+
+    // Class for 2-dimensional dynamic arrays of bits. Every row is stored in
+    // a whole number of 64-bit blocks, so that BitArray2::get and
+    // BitArray2::set only require a shift and a mask, and rows can be
+    // compared a block at a time. Unlike DynamicArray2<bool>, columns cannot
+    // be added one at a time; BitArray2::reset changes the number of columns
+    // and clears every entry, but keeps the memory already allocated.
+    class BitArray2 final {
+     public:
+      using block_type = uint64_t;
+
+      static constexpr size_t bits_per_block = 64;
+
+      // Not noexcept because BitArray2::add_rows can throw.
+      explicit BitArray2(size_t nr_cols = 0, size_t nr_rows = 0)
+          : _blocks(),
+            _nr_blocks_per_row(nr_blocks(nr_cols)),
+            _nr_cols(nr_cols),
+            _nr_rows(0) {
+        add_rows(nr_rows);
+      }
+
+      BitArray2(BitArray2 const&) = default;
+      BitArray2(BitArray2&&)      = default;
+      BitArray2& operator=(BitArray2 const&) = default;
+      BitArray2& operator=(BitArray2&&) = default;
+      ~BitArray2()                      = default;
+
+      bool operator==(BitArray2 const& that) const noexcept {
+        return _nr_cols == that._nr_cols && _nr_rows == that._nr_rows
+               && std::equal(_blocks.cbegin(),
+                             _blocks.cbegin() + _nr_rows * _nr_blocks_per_row,
+                             that._blocks.cbegin());
+      }
+
+      bool operator!=(BitArray2 const& that) const noexcept {
+        return !operator==(that);
+      }
+
+      size_t nr_cols() const noexcept {
+        return _nr_cols;
+      }
+
+      size_t nr_rows() const noexcept {
+        return _nr_rows;
+      }
+
+      size_t nr_blocks_per_row() const noexcept {
+        return _nr_blocks_per_row;
+      }
+
+      bool get(size_t i, size_t j) const noexcept {
+        LIBSEMIGROUPS_ASSERT(i < _nr_rows);
+        LIBSEMIGROUPS_ASSERT(j < _nr_cols);
+        return (block(i, j / bits_per_block) >> (j % bits_per_block)) & 1;
+      }
+
+      void set(size_t i, size_t j, bool val) noexcept {
+        LIBSEMIGROUPS_ASSERT(i < _nr_rows);
+        LIBSEMIGROUPS_ASSERT(j < _nr_cols);
+        block_type& x    = _blocks[i * _nr_blocks_per_row + j / bits_per_block];
+        block_type  mask = block_type(1) << (j % bits_per_block);
+        x = (val ? x | mask : x & ~mask);
+      }
+
+      // Not noexcept because std::vector::resize can throw.
+      void add_rows(size_t nr) {
+        _nr_rows += nr;
+        _blocks.resize(_nr_rows * _nr_blocks_per_row, 0);
+      }
+
+      // Not noexcept because std::vector::reserve can throw.
+      void reserve(size_t nr_rows) {
+        _blocks.reserve(nr_rows * _nr_blocks_per_row);
+      }
+
+      // Sets every entry to false.
+      void clear() noexcept {
+        std::fill(_blocks.begin(), _blocks.end(), 0);
+      }
+
+      // Changes the dimensions of this, and sets every entry to false.
+      // Not noexcept because std::vector::assign can throw.
+      void reset(size_t nr_cols, size_t nr_rows) {
+        _nr_blocks_per_row = nr_blocks(nr_cols);
+        _nr_cols           = nr_cols;
+        _nr_rows           = nr_rows;
+        _blocks.assign(_nr_rows * _nr_blocks_per_row, 0);
+      }
+
+      // Returns the least column j' >= j such that get(i, j') is false, or
+      // nr_cols() if there is no such column.
+      size_t next_unset(size_t i, size_t j) const noexcept {
+        return next(j, [this, i](size_t b) { return ~block(i, b); });
+      }
+
+      // Returns the least column j' >= j such that get(k, j') is true and
+      // get(i, j') is false, or nr_cols() if there is no such column.
+      size_t next_difference(size_t k, size_t i, size_t j) const noexcept {
+        return next(
+            j, [this, i, k](size_t b) { return block(k, b) & ~block(i, b); });
+      }
+
+      // The blocks of row i, for reading and writing whole rows at once; the
+      // unused bits of the last block of every row must be false.
+      block_type* row(size_t i) noexcept {
+        LIBSEMIGROUPS_ASSERT(i < _nr_rows);
+        return _blocks.data() + i * _nr_blocks_per_row;
+      }
+
+      block_type const* row(size_t i) const noexcept {
+        LIBSEMIGROUPS_ASSERT(i < _nr_rows);
+        return _blocks.data() + i * _nr_blocks_per_row;
+      }
+
+     private:
+      static size_t nr_blocks(size_t nr_cols) noexcept {
+        return (nr_cols + bits_per_block - 1) / bits_per_block;
+      }
+
+      static size_t nr_trailing_zeros(block_type x) noexcept {
+        LIBSEMIGROUPS_ASSERT(x != 0);
+#if defined(__GNUC__)
+        return __builtin_ctzll(x);
+#else
+        size_t n = 0;
+        while ((x & 1) == 0) {
+          x >>= 1;
+          ++n;
+        }
+        return n;
+#endif
+      }
+
+      block_type block(size_t i, size_t b) const noexcept {
+        return _blocks[i * _nr_blocks_per_row + b];
+      }
+
+      // Returns the least j' >= j such that bit j' % bits_per_block of
+      // f(j' / bits_per_block) is set, or nr_cols() if there is no such j'.
+      template <typename F>
+      size_t next(size_t j, F f) const noexcept {
+        if (j >= _nr_cols) {
+          return _nr_cols;
+        }
+        size_t     b = j / bits_per_block;
+        block_type x = f(b) & (~block_type(0) << (j % bits_per_block));
+        while (x == 0) {
+          if (++b == _nr_blocks_per_row) {
+            return _nr_cols;
+          }
+          x = f(b);
+        }
+        return std::min(b * bits_per_block + nr_trailing_zeros(x), _nr_cols);
+      }
+
+      std::vector<block_type> _blocks;
+      size_t                  _nr_blocks_per_row;
+      size_t                  _nr_cols;
+      size_t                  _nr_rows;
+    };
+
+    // Template class for an open-addressing (linear probing) hash index into
+    // a container that is stored elsewhere. Only the indices of the keys in
+    // that container, and their hash values, are stored; equality of keys is
+    // decided by a function object passed to FlatHashIndex::find that
+    // compares the key being sought with the key at a given index. The hash
+    // values are stored so that rehashing never requires the keys, and so
+    // that most unsuccessful comparisons are decided without reading them.
+    //
+    // FlatHashIndex::find is const and does not modify anything, and so can
+    // be called concurrently from several threads, provided that no thread
+    // calls a non-const member function at the same time.
+    template <typename T>
+    class FlatHashIndex final {
+     public:
+      using index_type = T;
+      using size_type  = size_t;
+
+      FlatHashIndex() : _hashes(), _indices(), _mask(0), _shift(64), _size(0) {}
+
+      FlatHashIndex(FlatHashIndex const&) = default;
+      FlatHashIndex(FlatHashIndex&&)      = default;
+      FlatHashIndex& operator=(FlatHashIndex const&) = default;
+      FlatHashIndex& operator=(FlatHashIndex&&) = default;
+      ~FlatHashIndex()                          = default;
+
+      size_type size() const noexcept {
+        return _size;
+      }
+
+      bool empty() const noexcept {
+        return _size == 0;
+      }
+
+      size_type capacity() const noexcept {
+        return _indices.size();
+      }
+
+      void clear() {
+        std::fill(_indices.begin(), _indices.end(), undefined());
+        _size = 0;
+      }
+
+      // Ensure that n indices can be inserted without rehashing.
+      void reserve(size_type n) {
+        size_type cap = (capacity() == 0 ? 16 : capacity());
+        while (max_size_before_rehash(cap) < n) {
+          cap *= 2;
+        }
+        if (cap != capacity()) {
+          rehash(cap);
+        }
+      }
+
+      // Returns the index i such that eq(i) is true, where hash is the hash
+      // value of the sought key; or UNDEFINED if there is no such index.
+      template <typename TEqual>
+      index_type find(size_t hash, TEqual&& eq) const {
+        size_type nr_probes;
+        return find(hash, std::forward<TEqual>(eq), nr_probes);
+      }
+
+      // As above, and also sets nr_probes to the number of slots inspected.
+      template <typename TEqual>
+      index_type find(size_t hash, TEqual&& eq, size_type& nr_probes) const {
+        nr_probes = 0;
+        if (_size == 0) {
+          return undefined();
+        }
+        for (size_type s = slot(hash);; s = (s + 1) & _mask) {
+          nr_probes++;
+          index_type const i = _indices[s];
+          if (i == undefined()) {
+            return undefined();
+          } else if (_hashes[s] == hash && eq(i)) {
+            return i;
+          }
+        }
+      }
+
+      // Insert the index i of a key with hash value hash. It is assumed that
+      // there is no equal key already in the index.
+      void insert(size_t hash, index_type i) {
+        LIBSEMIGROUPS_ASSERT(i != undefined());
+        if (_size + 1 > max_size_before_rehash(capacity())) {
+          rehash(capacity() == 0 ? 16 : 2 * capacity());
+        }
+        insert_no_rehash(hash, i);
+        _size++;
+      }
+
+     private:
+      static constexpr index_type undefined() noexcept {
+        return static_cast<index_type>(UNDEFINED);
+      }
+
+      // Maximum load factor is 3 / 4.
+      static constexpr size_type max_size_before_rehash(size_type cap) {
+        return cap - (cap / 4);
+      }
+
+      // Fibonacci hashing, so that poorly distributed hash values (such as
+      // those of std::hash<size_t>) are spread over the whole table.
+      size_type slot(size_t hash) const noexcept {
+        return static_cast<size_type>(
+                   (static_cast<uint64_t>(hash) * 0x9E3779B97F4A7C15ULL)
+                   >> _shift)
+               & _mask;
+      }
+
+      void insert_no_rehash(size_t hash, index_type i) {
+        size_type s = slot(hash);
+        while (_indices[s] != undefined()) {
+          s = (s + 1) & _mask;
+        }
+        _hashes[s]  = hash;
+        _indices[s] = i;
+      }
+
+      void rehash(size_type cap) {
+        LIBSEMIGROUPS_ASSERT((cap & (cap - 1)) == 0);
+        std::vector<size_t>     hashes(cap, 0);
+        std::vector<index_type> indices(cap, undefined());
+        std::swap(hashes, _hashes);
+        std::swap(indices, _indices);
+        _mask  = cap - 1;
+        _shift = 64;
+        while (cap > 1) {
+          cap >>= 1;
+          _shift--;
+        }
+        for (size_type s = 0; s < indices.size(); ++s) {
+          if (indices[s] != undefined()) {
+            insert_no_rehash(hashes[s], indices[s]);
+          }
+        }
+      }
+
+      std::vector<size_t>     _hashes;
+      std::vector<index_type> _indices;
+      size_type               _mask;
+      size_t                  _shift;
+      size_type               _size;
+    };
+
+    // Template class for storing many objects of a fixed size type T in a
+    // small number of large contiguous blocks of memory. The objects are
+    // copy constructed into the blocks in the order they are added, and so
+    // objects that are added consecutively are adjacent in memory. The start
+    // of every block is aligned to a cache line. The objects are never moved,
+    // and so pointers to them remain valid until the Arena is destroyed, or
+    // they are freed. The memory of a block is released once every object in
+    // it has been freed, except for the block that objects are currently
+    // being added to. Since T must be trivially copyable, its destructor is
+    // trivial, and so the objects are not destroyed either.
+    template <typename T>
+    class Arena final {
+      static_assert(std::is_trivially_copyable<T>::value,
+                    "the template parameter T must be trivially copyable");
+
+     public:
+      using value_type    = T;
+      using pointer       = T*;
+      using const_pointer = T const*;
+      using size_type     = size_t;
+
+      static constexpr size_t cache_line_size = 64;
+
+      Arena()
+          : _blocks(),
+            _live(),
+            _memory(),
+            _next(nullptr),
+            _size(0),
+            _spare(0),
+            _starts() {}
+
+      // Moving an Arena does not move the objects in it, and so pointers to
+      // them remain valid, but copying an Arena would not preserve them.
+      Arena(Arena&& that)
+          : _blocks(std::move(that._blocks)),
+            _live(std::move(that._live)),
+            _memory(std::move(that._memory)),
+            _next(that._next),
+            _size(that._size),
+            _spare(that._spare),
+            _starts(std::move(that._starts)) {
+        that._blocks.clear();
+        that._live.clear();
+        that._memory.clear();
+        that._next  = nullptr;
+        that._size  = 0;
+        that._spare = 0;
+        that._starts.clear();
+      }
+
+      Arena(Arena const&) = delete;
+      Arena& operator=(Arena const&) = delete;
+      Arena& operator=(Arena&&) = delete;
+      ~Arena()                  = default;
+
+      // Returns the number of objects in the arena.
+      size_type size() const noexcept {
+        return _size;
+      }
+
+      // Returns the object in position i, in the order that objects were
+      // added, which must not have been freed.
+      const_pointer operator[](size_type i) const noexcept {
+        LIBSEMIGROUPS_ASSERT(i < _size);
+        size_type b = 0;
+        while (i >= _blocks[b].first) {
+          i -= _blocks[b].first;
+          b++;
+        }
+        return reinterpret_cast<const_pointer>(_blocks[b].second) + i;
+      }
+
+      // Copy x into the arena and return a pointer to the copy.
+      pointer copy(T const& x) {
+        if (_spare == 0) {
+          add_block();
+        }
+        pointer p = new (_next) T(x);
+        _next += sizeof(T);
+        _spare--;
+        _size++;
+        _live.back()++;
+        return p;
+      }
+
+      // Free the object p, which must have been returned by copy, and not
+      // already freed. If every object in the block containing p has been
+      // freed, and objects are no longer being added to that block, then the
+      // memory of the block is released.
+      void free(const_pointer p) {
+        auto it = _starts.upper_bound(reinterpret_cast<char const*>(p));
+        LIBSEMIGROUPS_ASSERT(it != _starts.cbegin());
+        --it;
+        size_type const b = it->second;
+        LIBSEMIGROUPS_ASSERT(_live[b] != 0);
+        if (--_live[b] == 0 && b != _blocks.size() - 1) {
+          release(b);
+        }
+      }
+
+      // Returns the number of blocks whose memory has not been released.
+      size_type nr_blocks() const noexcept {
+        return _starts.size();
+      }
+
+     private:
+      // The maximum number of objects in a block, so that a block occupies at
+      // most 4MB (unless a single T is larger than that).
+      static constexpr size_type max_block_size() {
+        return (sizeof(T) >= (size_t(1) << 22) ? 1
+                                               : (size_t(1) << 22) / sizeof(T));
+      }
+
+      // Each block can hold twice as many objects as the previous one, up to
+      // max_block_size().
+      void add_block() {
+        if (!_blocks.empty() && _live.back() == 0) {
+          release(_blocks.size() - 1);
+        }
+        size_type const n
+            = std::min(_blocks.empty() ? 64 : 2 * _blocks.back().first,
+                       max_block_size());
+        std::unique_ptr<char[]> mem(
+            new char[n * sizeof(T) + cache_line_size - 1]);
+        uintptr_t addr = reinterpret_cast<uintptr_t>(mem.get());
+        addr = (addr + cache_line_size - 1) & ~(uintptr_t(cache_line_size) - 1);
+        _next  = reinterpret_cast<char*>(addr);
+        _spare = n;
+        _starts.emplace(_next, _blocks.size());
+        _blocks.emplace_back(n, _next);
+        _live.push_back(0);
+        _memory.push_back(std::move(mem));
+      }
+
+      void release(size_type b) {
+        _starts.erase(_blocks[b].second);
+        _memory[b].reset();
+      }
+
+      // The number of objects that fit into a block, and the aligned start of
+      // the block.
+      std::vector<std::pair<size_type, char*>> _blocks;
+      // The number of objects in each block that have not been freed.
+      std::vector<size_type>               _live;
+      std::vector<std::unique_ptr<char[]>> _memory;
+      char*                                _next;
+      size_type                            _size;
+      size_type                            _spare;
+      // The index in _blocks of the block starting at a given address, for
+      // the blocks that have not been released.
+      std::map<char const*, size_type> _starts;
+    };
   }  // namespace detail
 }  // namespace libsemigroups
 #endif  // LIBSEMIGROUPS_INCLUDE_CONTAINERS_HPP_
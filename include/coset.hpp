@@ -23,10 +23,14 @@
 #define LIBSEMIGROUPS_INCLUDE_COSET_HPP_
 
 #include <cstddef>  // for size_t
+#include <cstdint>  // for uint8_t
+#include <iosfwd>   // for istream, ostream
+#include <utility>  // for swap
 #include <vector>   // for vector
 
 #include "constants.hpp"            // for UNDEFINED
 #include "libsemigroups-debug.hpp"  // for LIBSEMIGROUPS_ASSERT/DEBUG
+#include "types.hpp"                // for table_index_type
 
 namespace libsemigroups {
   namespace detail {
@@ -36,7 +40,7 @@ namespace libsemigroups {
       // CosetManager - typedefs - public
       ////////////////////////////////////////////////////////////////////////
 
-      using coset_type = size_t;
+      using coset_type = table_index_type;
 
       ////////////////////////////////////////////////////////////////////////
       // CosetManager - constructors + destructor - public
@@ -102,12 +106,26 @@ namespace libsemigroups {
       // CosetManager - member functions - protected
       ////////////////////////////////////////////////////////////////////////
 
+      // Identifies the distinct active cosets <min> and <max>, and kills one
+      // of them. The coset with the lower rank is killed (union by rank),
+      // ties are broken by killing the larger coset, and the identity coset
+      // is never killed. On return <min> is the surviving coset and <max> is
+      // the killed one.
+      //
       // not noexcept because free_coset isn't, and std::vector::operator[]
       // isn't.
-      inline void union_cosets(coset_type const min, coset_type const max) {
+      inline void union_cosets(coset_type& min, coset_type& max) {
         LIBSEMIGROUPS_ASSERT(is_active_coset(min));
         LIBSEMIGROUPS_ASSERT(is_active_coset(max));
-        LIBSEMIGROUPS_ASSERT(max > min);
+        LIBSEMIGROUPS_ASSERT(min != max);
+        if (min > max) {
+          std::swap(min, max);
+        }
+        if (min != _id_coset && _rank[max] > _rank[min]) {
+          std::swap(min, max);
+        } else if (_rank[max] == _rank[min]) {
+          _rank[min]++;
+        }
         _active--;
         _cosets_killed++;
         free_coset(max);
@@ -116,11 +134,16 @@ namespace libsemigroups {
         _ident[max] = min;
       }
 
+      // Returns the active coset that <c> was identified with, making every
+      // other coset on the chain of forwarding addresses from <c> point to its
+      // grandparent (path halving).
+      //
       // not noexcept since std::vector::operator[] isn't.
-      inline coset_type find_coset(coset_type c) const {
+      inline coset_type find_coset(coset_type c) {
         LIBSEMIGROUPS_ASSERT(is_valid_coset(c));
         while (_ident[c] != c) {
-          c = _ident[c];
+          _ident[c] = _ident[_ident[c]];
+          c         = _ident[c];
         }
         LIBSEMIGROUPS_ASSERT(is_active_coset(c));
         return c;
@@ -132,6 +155,20 @@ namespace libsemigroups {
       coset_type new_active_coset();
       void       switch_cosets(coset_type const, coset_type const);
 
+      // Write all of the data of this to the binary stream <os>, for use in
+      // checkpointing.
+      void write_cosets(std::ostream&) const;
+
+      // Replace all of the data of this by that read from the binary stream
+      // <is>, which must have been written by write_cosets for a CosetManager
+      // with capacity <n>. Throws, and this is unchanged, if the data read is
+      // not valid.
+      void read_cosets(std::istream&, size_t);
+
+      // Exchanges all of the data of this and <that>, in constant time, for
+      // use when a ToddCoxeter adopts the coset table of another.
+      void swap_cosets(CosetManager& that) noexcept;
+
       ////////////////////////////////////////////////////////////////////////
       // CosetManager - data - protected
       ////////////////////////////////////////////////////////////////////////
@@ -160,6 +197,7 @@ namespace libsemigroups {
       std::vector<coset_type> _forwd;
       std::vector<coset_type> _ident;
       coset_type              _last_active_coset;
+      std::vector<uint8_t>    _rank;
 
 #ifdef LIBSEMIGROUPS_DEBUG
 
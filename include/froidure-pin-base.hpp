@@ -23,9 +23,16 @@
 #ifndef LIBSEMIGROUPS_INCLUDE_FROIDURE_PIN_BASE_HPP_
 #define LIBSEMIGROUPS_INCLUDE_FROIDURE_PIN_BASE_HPP_
 
+#include <atomic>      // for atomic
+#include <chrono>      // for nanoseconds
 #include <cstddef>     // for size_t
+#include <cstdint>     // for uint64_t
 #include <functional>  // for function
+#include <iosfwd>      // for ostream
+#include <string>      // for string
 #include <thread>      // for thread::hardware_concurrency
+#include <utility>     // for pair
+#include <vector>      // for vector
 
 #include "constants.hpp"   // for LIMIT_MAX
 #include "containers.hpp"  // for DynamicArray2
@@ -33,6 +40,126 @@
 #include "types.hpp"       // for word_type, letter_type, tril
 
 namespace libsemigroups {
+  namespace detail {
+    // A counter that can be updated by several threads at once, and which,
+    // unlike std::atomic, can be copied.
+    class StatsCounter final {
+     public:
+      StatsCounter() noexcept : _value(0) {}
+      StatsCounter(StatsCounter const& that) noexcept : _value(that.get()) {}
+      StatsCounter& operator=(StatsCounter const& that) noexcept {
+        _value.store(that.get(), std::memory_order_relaxed);
+        return *this;
+      }
+      ~StatsCounter() = default;
+
+      uint64_t get() const noexcept {
+        return _value.load(std::memory_order_relaxed);
+      }
+
+      void add(uint64_t n) noexcept {
+        _value.fetch_add(n, std::memory_order_relaxed);
+      }
+
+      // Replace the value by n if n is larger.
+      void max(uint64_t n) noexcept {
+        uint64_t v = get();
+        while (v < n
+               && !_value.compare_exchange_weak(
+                   v, n, std::memory_order_relaxed)) {
+        }
+      }
+
+     private:
+      std::atomic<uint64_t> _value;
+    };
+  }  // namespace detail
+
+  //! Defined in ``froidure-pin-base.hpp``.
+  //!
+  //! The statistics about the enumeration of a FroidurePin instance returned
+  //! by FroidurePin::stats. These are only collected if libsemigroups is
+  //! configured with ``--enable-stats`` (i.e. if \c LIBSEMIGROUPS_STATS is
+  //! defined), otherwise FroidurePinStats::enabled is \c false and all the
+  //! other values are \c 0.
+  //!
+  //! Only the work done by FroidurePin::run is recorded in
+  //! FroidurePinStats::layers, not that done by FroidurePin::add_generators
+  //! or FroidurePin::closure. Every lookup in the hash table is counted,
+  //! including those made by FroidurePin::position and so on.
+  struct FroidurePinStats {
+    //! The statistics for the elements whose minimal words have the same
+    //! length, and for the products of these elements and the generators.
+    struct Layer {
+      //! The length of the minimal words.
+      size_t length = 0;
+      //! The number of elements whose minimal words have length
+      //! FroidurePinStats::Layer::length.
+      uint64_t nr_elements = 0;
+      //! The number of products of these elements and the generators that
+      //! were computed.
+      uint64_t nr_products = 0;
+      //! The number of products of these elements and the generators that
+      //! were determined from the right Cayley graph, using the suffix of the
+      //! minimal word, rather than computed.
+      uint64_t nr_products_avoided = 0;
+      //! The number of computed products that were new elements.
+      uint64_t nr_new = 0;
+      //! The number of computed products that were already known, each of
+      //! these gives a relation.
+      uint64_t nr_duplicates = 0;
+      //! The time spent multiplying these elements by the generators.
+      std::chrono::nanoseconds time = std::chrono::nanoseconds(0);
+    };
+
+    //! Whether or not the statistics were collected.
+    bool enabled = false;
+    //! The total of FroidurePinStats::Layer::nr_products over all layers.
+    uint64_t nr_products = 0;
+    //! The total of FroidurePinStats::Layer::nr_products_avoided over all
+    //! layers.
+    uint64_t nr_products_avoided = 0;
+    //! The number of lookups in the hash table.
+    uint64_t nr_hash_lookups = 0;
+    //! The total number of slots of the hash table inspected by the lookups,
+    //! the average probe length is this divided by
+    //! FroidurePinStats::nr_hash_lookups.
+    uint64_t nr_hash_probes = 0;
+    //! The largest number of slots inspected by a single lookup.
+    uint64_t max_hash_probe_length = 0;
+    //! The number of comparisons of elements made by the lookups, i.e. the
+    //! number of inspected slots whose hash value was equal to that of the
+    //! element being looked up.
+    uint64_t nr_hash_comparisons = 0;
+    //! The statistics for each word length, in increasing order of length.
+    std::vector<Layer> layers;
+
+    //! Write the statistics to \p os as a JSON object.
+    //!
+    //! The keys of the object are the names of the data members of
+    //! FroidurePinStats, and the value of \c "layers" is an array of objects
+    //! whose keys are the names of the data members of
+    //! FroidurePinStats::Layer. Times are given in nanoseconds, with keys
+    //! ending in \c "_ns".
+    //!
+    //! \param os the stream to write to.
+    //!
+    //! \returns
+    //! (None).
+    //!
+    //! \exceptions
+    //! \no_libsemigroups_except
+    void to_json(std::ostream& os) const;
+
+    //! Returns the statistics as a JSON object.
+    //!
+    //! \returns A \c std::string, see to_json(std::ostream&) const.
+    //!
+    //! \exceptions
+    //! \no_libsemigroups_except
+    std::string to_json() const;
+  };
+
   //! Defined in ``froidure-pin-base.hpp``.
   //!
   //! FroidurePinBase is an abstract base class for the class template
@@ -49,7 +176,7 @@ namespace libsemigroups {
     // It should be possible to change this type and everything will just work,
     // provided the size of the semigroup is less than the maximum value of
     // this type of integer.
-    using size_type = size_t;
+    using size_type = table_index_type;
 
     //! Type for the position of an element in an instance of FroidurePin. The
     //! size of the semigroup being enumerated must be at most
@@ -192,6 +319,7 @@ namespace libsemigroups {
     //! implementation:
     //!
     //! * FroidurePin::nr_idempotents
+    //! * FroidurePin::enumerate
     //!
     //! The default value is **823543**.
     //!
@@ -314,6 +442,21 @@ namespace libsemigroups {
     //! \copydoc FroidurePin::fast_product
     virtual element_index_type fast_product(element_index_type,
                                             element_index_type) const = 0;
+
+    //! \copydoc FroidurePin::words_to_pos
+    virtual void words_to_pos(std::vector<word_type> const&,
+                              std::vector<element_index_type>&) const = 0;
+
+    //! \copydoc FroidurePin::products_by_reduction
+    virtual void products_by_reduction(
+        std::vector<std::pair<element_index_type, element_index_type>> const&,
+        std::vector<element_index_type>&) const = 0;
+
+    //! \copydoc FroidurePin::fast_products
+    virtual void fast_products(
+        std::vector<std::pair<element_index_type, element_index_type>> const&,
+        std::vector<element_index_type>&) const = 0;
+
     //! \copydoc FroidurePin::letter_to_pos
     virtual element_index_type letter_to_pos(letter_type) const = 0;
 
@@ -413,5 +556,103 @@ namespace libsemigroups {
 
   //! \copydoc libsemigroups::relations
   void relations(FroidurePinBase& S, std::function<void(word_type)>&& hook);
+
+  //! Applies the function \p hook to every defining relation of \p S.
+  //!
+  //! Unlike libsemigroups::relations, the sides of every relation are
+  //! written into the same two words, which are passed to \p hook by
+  //! reference, and so no memory is allocated for each relation. The
+  //! references passed to \p hook are only valid until \p hook returns.
+  //!
+  //! \param S the FroidurePinBase whose relations are sought
+  //! \param hook the hook function to apply
+  //!
+  //! \returns
+  //! (None).
+  //!
+  //! \exceptions
+  //! \no_libsemigroups_except
+  //!
+  //! \complexity
+  //! \f$O(|S||A|)\f$ where \f$A\f$ is the generating set for the parameter
+  //! \f$S\f$.
+  void for_each_relation(
+      FroidurePinBase&                                          S,
+      std::function<void(word_type const&, word_type const&)>&& hook);
+
+  //! Applies the function \p hook to the position and minimal factorisation
+  //! of every element of \p S.
+  //!
+  //! Every minimal factorisation is written into the same word, which is
+  //! passed to \p hook by reference, and so no memory is allocated for
+  //! each element. The reference passed to \p hook is only valid until \p
+  //! hook returns.
+  //!
+  //! \param S the FroidurePinBase whose elements are sought
+  //! \param hook the hook function to apply
+  //!
+  //! \returns
+  //! (None).
+  //!
+  //! \exceptions
+  //! \no_libsemigroups_except
+  //!
+  //! \complexity
+  //! The sum of the lengths of the minimal factorisations of the elements of
+  //! \p S, once \p S is fully enumerated.
+  void for_each_normal_form(
+      FroidurePinBase& S,
+      std::function<void(FroidurePinBase::element_index_type,
+                         word_type const&)>&& hook);
+
+  //! Writes the minimal factorisations of the elements of \p S to a file.
+  //!
+  //! The minimal factorisations are written in order of the positions of
+  //! the elements, in the format read by libsemigroups::read_words. The
+  //! numbers in this format are written in a variable number of bytes, and
+  //! so a word in at most 128 generators uses one byte per letter. The file
+  //! does not depend on the endianness of the platform.
+  //!
+  //! \param S the FroidurePinBase whose elements are sought
+  //! \param path the name of the file to write
+  //!
+  //! \returns
+  //! (None).
+  //!
+  //! \throws LibsemigroupsException if the file cannot be written.
+  void write_normal_forms(FroidurePinBase& S, std::string const& path);
+
+  //! Writes the defining relations of \p S to a file.
+  //!
+  //! The left and right hand sides of every relation, in the order they are
+  //! found by libsemigroups::for_each_relation, are written to the file
+  //! \p path in the format read by libsemigroups::read_words, so that the
+  //! file contains twice as many words as there are relations.
+  //!
+  //! \param S the FroidurePinBase whose relations are sought
+  //! \param path the name of the file to write
+  //!
+  //! \returns
+  //! (None).
+  //!
+  //! \throws LibsemigroupsException if the file cannot be written.
+  void write_relations(FroidurePinBase& S, std::string const& path);
+
+  //! Applies the function \p hook to every word in a file written by
+  //! libsemigroups::write_normal_forms or libsemigroups::write_relations.
+  //!
+  //! Every word is read into the same word, which is passed to \p hook by
+  //! reference.
+  //!
+  //! \param path the name of the file to read
+  //! \param hook the hook function to apply
+  //!
+  //! \returns
+  //! (None).
+  //!
+  //! \throws LibsemigroupsException if the file cannot be read, or is not in
+  //! the correct format.
+  void read_words(std::string const&                      path,
+                  std::function<void(word_type const&)>&& hook);
 }  // namespace libsemigroups
 #endif  // LIBSEMIGROUPS_INCLUDE_FROIDURE_PIN_BASE_HPP_
@@ -19,6 +19,17 @@
 // This file contains implementations of the member functions for the
 // FroidurePin class.
 
+#include <algorithm>   // for min
+#include <array>       // for array
+#include <chrono>      // for nanoseconds
+#include <cmath>       // for ceil
+#include <cstdio>      // for rename
+#include <cstdint>     // for uint64_t
+#include <fstream>     // for ifstream, ofstream
+#include <functional>  // for function
+#include <numeric>     // for iota
+
+#include "binary-io.hpp"                // for read_binary, write_binary
 #include "libsemigroups-debug.hpp"      // for LIBSEMIGROUPS_ASSERT
 #include "libsemigroups-exception.hpp"  // for LIBSEMIGROUPS_EXCEPTION
 #include "report.hpp"                   // for REPORT
@@ -46,6 +57,9 @@ namespace libsemigroups {
   // using enumerate_index_type = FroidurePinBase::size_type;
   using element_index_type = FroidurePinBase::element_index_type;
 
+  TEMPLATE constexpr size_t FROIDURE_PIN::trace_batch_size;
+  TEMPLATE constexpr size_t FROIDURE_PIN::calibration_sample_size;
+
   ////////////////////////////////////////////////////////////////////////
   // FroidurePin - constructors + destructor - public
   ////////////////////////////////////////////////////////////////////////
@@ -58,15 +72,18 @@ namespace libsemigroups {
         _duplicate_gens(),
         _elements(),
         _enumerate_order(),
+        _fast_product_threshold(UNDEFINED),
         _final(),
         _first(),
         _found_one(false),
         _gens(),
         _id(),
+        _idempotent_threshold(UNDEFINED),
         _idempotents(),
         _idempotents_found(false),
         _is_idempotent(),
         _left(gens->size()),
+        _left_lazy(false),
         _length(),
         _lenindex(),
         _letter_to_pos(),
@@ -75,6 +92,8 @@ namespace libsemigroups {
         _nr(0),
         _nrgens(gens->size()),
         _nr_rules(0),
+        _nr_shared(0),
+        _nr_spilled(0),
         _pos(0),
         _pos_one(0),
         _prefix(),
@@ -82,7 +101,10 @@ namespace libsemigroups {
         _relation_gen(0),
         _relation_pos(UNDEFINED),
         _right(gens->size()),
+        _shared(),
         _sorted(),
+        _spill(),
+        _storage(),
         _suffix(),
         _tmp_product(),
         _wordlen(0) {  // (length of the current word) - 1
@@ -109,25 +131,21 @@ namespace libsemigroups {
       }
     }
     for (const_reference x : *gens) {
-      _gens.push_back(this->internal_copy(this->to_internal_const(x)));
+      _gens.push_back(_storage.copy(this->to_internal_const(x)));
     }
 
     _tmp_product = this->to_internal(One()(this->to_external_const(_gens[0])));
     _id          = this->to_internal(One()(this->to_external_const(_gens[0])));
     _lenindex.push_back(0);
 
-    // #ifdef LIBSEMIGROUPS_DENSEHASHMAP
-    //     _map.set_empty_key(this->empty_key(_id));
-    // #endif
-
     // add the generators
     for (letter_type i = 0; i < _nrgens; i++) {
-      auto it = _map.find(_gens[i]);
-      if (it != _map.end()) {  // duplicate generator
-        _letter_to_pos.push_back(it->second);
+      element_index_type pos = map_find(_gens[i]);
+      if (pos != UNDEFINED) {  // duplicate generator
+        _letter_to_pos.push_back(pos);
         _nr_rules++;
-        _duplicate_gens.emplace_back(i, _first[it->second]);
-        // i.e. _gens[i] = _gens[_first[it->second]]
+        _duplicate_gens.emplace_back(i, _first[pos]);
+        // i.e. _gens[i] = _gens[_first[pos]]
         // _first maps from element_index_type -> letter_type :)
       } else {
         is_one(_gens[i], _nr);
@@ -139,7 +157,7 @@ namespace libsemigroups {
         _enumerate_order.push_back(_nr);
         _letter_to_pos.push_back(_nr);
         _length.push_back(1);
-        _map.emplace(_elements.back(), _nr);
+        map_insert(_nr);
         _prefix.push_back(UNDEFINED);
         // TODO(later) _prefix.push_back(_nr) and get rid of _letter_to_pos, and
         // the extra clause in the run member function!
@@ -165,23 +183,29 @@ namespace libsemigroups {
         FroidurePinBase(S),
         _degree(S._degree),
         _duplicate_gens(S._duplicate_gens),
-        _elements(),
+        _elements(S._elements),
         _enumerate_order(S._enumerate_order),
+        _fast_product_threshold(S._fast_product_threshold),
         _final(S._final),
         _first(S._first),
         _found_one(S._found_one),
         _gens(),
         _id(this->internal_copy(S._id)),
+        _idempotent_threshold(S._idempotent_threshold),
         _idempotents(S._idempotents),
         _idempotents_found(S._idempotents_found),
         _is_idempotent(S._is_idempotent),
         _left(S._left),
+        _left_lazy(S._left_lazy),
         _length(S._length),
         _lenindex(S._lenindex),
         _letter_to_pos(S._letter_to_pos),
+        _map(S._map),
         _nr(S._nr),
         _nrgens(S._nrgens),
         _nr_rules(S._nr_rules),
+        _nr_shared(0),
+        _nr_spilled(0),
         _pos(S._pos),
         _pos_one(S._pos_one),
         _prefix(S._prefix),
@@ -189,30 +213,27 @@ namespace libsemigroups {
         _relation_gen(S._relation_gen),
         _relation_pos(S._relation_pos),
         _right(S._right),
+        _shared(),
         _sorted(),  // TODO(later) S this if set
+        _spill(),
+        _storage(),
         _suffix(S._suffix),
         _wordlen(S._wordlen) {
+    if (S._spill != nullptr) {
+      this->internal_free(_id);
+      LIBSEMIGROUPS_EXCEPTION("cannot copy a FroidurePin instance that "
+                              "spills elements, call spill(\"\") first");
+    }
 #ifdef LIBSEMIGROUPS_VERBOSE
     _nr_products = 0;
 #endif
-    _elements.reserve(_nr);
-
-    // #ifdef LIBSEMIGROUPS_DENSEHASHMAP
-    //     _map.set_empty_key(this->empty_key(_id));
-    //     _map.resize(_nr);
-    // #else
-    //     // _map.reserve(_nr); // FIXME(later) uncommenting this line causes
-    //     huge
-    //     // slow down in FroidurePin 000
-    // #endif
     _tmp_product = this->internal_copy(S._id);
 
-    element_index_type i = 0;
-    for (internal_const_reference x : S._elements) {
-      auto y = this->internal_copy(x);
-      _elements.push_back(y);
-      _map.emplace(y, i++);
-    }
+    // The elements of S are shared rather than copied, and so _map, which
+    // only depends on their hash values, can be copied too.
+    S.share_elements();
+    _shared    = S._shared;
+    _nr_shared = S._nr_shared;
     copy_gens();
   }
 
@@ -221,13 +242,7 @@ namespace libsemigroups {
     this->internal_free(_tmp_product);
     this->internal_free(_id);
 
-    // delete those generators not in _elements, i.e. the duplicate ones
-    for (auto& x : _duplicate_gens) {
-      this->internal_free(_gens[x.first]);
-    }
-    for (auto& x : _elements) {
-      this->internal_free(x);
-    }
+    free_elements();
   }
 
   ////////////////////////////////////////////////////////////////////////
@@ -259,17 +274,22 @@ namespace libsemigroups {
       : _degree(S._degree),  // copy for comparison in add_generators
         _duplicate_gens(S._duplicate_gens),
         _elements(),
+        _fast_product_threshold(UNDEFINED),
         _found_one(S._found_one),  // copy in case degree doesn't change in
                                    // add_generators
         _gens(),
+        _idempotent_threshold(UNDEFINED),
         _idempotents(S._idempotents),
         _idempotents_found(S._idempotents_found),
         _is_idempotent(S._is_idempotent),
         _left(S._left),
+        _left_lazy(S._left_lazy),
         _letter_to_pos(S._letter_to_pos),
         _nr(S._nr),
         _nrgens(S._nrgens),
         _nr_rules(0),
+        _nr_shared(0),
+        _nr_spilled(0),
         _pos(S._pos),
         _pos_one(S._pos_one),  // copy in case degree doesn't change in
                                // add_generators
@@ -277,10 +297,17 @@ namespace libsemigroups {
         _relation_gen(0),
         _relation_pos(UNDEFINED),
         _right(S._right),
+        _shared(),
         _sorted(),
+        _spill(),
+        _storage(),
         _wordlen(0) {
     LIBSEMIGROUPS_ASSERT(!coll->empty());
     LIBSEMIGROUPS_ASSERT(Degree()(coll->at(0)) >= S.degree());
+    if (S._spill != nullptr) {
+      LIBSEMIGROUPS_EXCEPTION("cannot copy a FroidurePin instance that "
+                              "spills elements, call spill(\"\") first");
+    }
 
 #ifdef LIBSEMIGROUPS_DEBUG
     for (const_reference x : *coll) {
@@ -290,8 +317,6 @@ namespace libsemigroups {
 #ifdef LIBSEMIGROUPS_VERBOSE
     _nr_products = 0;
 #endif
-    _elements.reserve(S._nr);
-
     // the following are required for assignment to specific positions in
     // add_generators
     _final.resize(S._nr, 0);
@@ -325,20 +350,26 @@ namespace libsemigroups {
     _id          = One()(this->to_internal(coll->at(0)));
     _tmp_product = this->internal_copy(_id);
 
-    // #ifdef LIBSEMIGROUPS_DENSEHASHMAP
-    //     _map.set_empty_key(this->empty_key(_id));
-    //     _map.resize(S._nr);
-    // #else
-    _map.reserve(S._nr);
-    // #endif
-
-    element_index_type i = 0;
-    for (internal_const_reference x : S._elements) {
-      auto y = this->internal_copy(x);
-      IncreaseDegree()(y, deg_plus);
-      _elements.push_back(y);
-      _map.emplace(y, i);
-      is_one(y, i++);
+    if (deg_plus == 0) {
+      // The elements of S are unchanged, and so they can be shared rather
+      // than copied, see the copy constructor.
+      S.share_elements();
+      _elements  = S._elements;
+      _map       = S._map;
+      _shared    = S._shared;
+      _nr_shared = S._nr_shared;
+    } else {
+      _elements.reserve(S._nr);
+      _map.reserve(S._nr);
+
+      element_index_type i = 0;
+      for (internal_const_reference x : S._elements) {
+        auto y = _storage.copy(x);
+        IncreaseDegree()(y, deg_plus);
+        _elements.push_back(y);
+        map_insert(i);
+        is_one(y, i++);
+      }
     }
     copy_gens();  // copy the old generators
     // Now this is ready to have add_generators or closure called on it
@@ -358,7 +389,7 @@ namespace libsemigroups {
     }
     element_index_type out = _letter_to_pos[w[0]];
     for (auto it = w.cbegin() + 1; it < w.cend() && out != UNDEFINED; ++it) {
-      out = _right.get(out, _letter_to_pos[*it]);
+      out = _right.get(out, *it);
     }
     return out;
   }
@@ -427,8 +458,7 @@ namespace libsemigroups {
       return UNDEFINED;
     }
 
-    auto it = _map.find(this->to_internal_const(x));
-    return (it == _map.end() ? UNDEFINED : it->second);
+    return map_find(this->to_internal_const(x));
   }
 
   SIZE_T FROIDURE_PIN::current_size() const noexcept {
@@ -481,7 +511,7 @@ namespace libsemigroups {
     validate_element_index(i);
     validate_element_index(j);
 
-    if (length_const(i) <= length_const(j)) {
+    if (!_left_lazy && length_const(i) <= length_const(j)) {
       while (i != UNDEFINED) {
         j = _left.get(j, _final[i]);
         i = _prefix[i];
@@ -500,19 +530,206 @@ namespace libsemigroups {
   FROIDURE_PIN::fast_product(element_index_type i, element_index_type j) const {
     validate_element_index(i);
     validate_element_index(j);
-    if (length_const(i)
-            < 2 * Complexity()(this->to_external_const(_tmp_product))
-        || length_const(j)
-               < 2 * Complexity()(this->to_external_const(_tmp_product))) {
+    if (length_const(i) < fast_product_threshold()
+        || length_const(j) < fast_product_threshold()) {
       return product_by_reduction(i, j);
     } else {
       Product()(this->to_external(_tmp_product),
                 this->to_external_const(_elements[i]),
                 this->to_external_const(_elements[j]));
-      return _map.find(_tmp_product)->second;
+      return map_find(_tmp_product);
     }
   }
 
+  VOID FROIDURE_PIN::words_to_pos(std::vector<word_type> const&    words,
+                                  std::vector<element_index_type>& out) const {
+    for (auto const& w : words) {
+      if (w.size() == 0) {
+        LIBSEMIGROUPS_EXCEPTION("the given word has length 0");
+      }
+      for (auto x : w) {
+        validate_letter_index(x);
+      }
+    }
+    out.resize(words.size());
+    for_each_block(words.size(),
+                   [this, &words, &out](size_t, size_t first, size_t last) {
+                     trace_words(words, out, first, last);
+                   });
+  }
+
+  VOID FROIDURE_PIN::products_by_reduction(
+      std::vector<std::pair<element_index_type, element_index_type>> const&
+                                       pairs,
+      std::vector<element_index_type>& out) const {
+    for (auto const& x : pairs) {
+      validate_element_index(x.first);
+      validate_element_index(x.second);
+    }
+    out.resize(pairs.size());
+    for_each_block(pairs.size(),
+                   [this, &pairs, &out](size_t, size_t first, size_t last) {
+                     std::array<size_t, trace_batch_size> idx;
+                     for (size_t k = first; k < last; k += trace_batch_size) {
+                       size_t const n = std::min(last - k, trace_batch_size);
+                       std::iota(idx.begin(), idx.begin() + n, k);
+                       trace_products(pairs, out, idx.data(), n);
+                     }
+                   });
+  }
+
+  VOID FROIDURE_PIN::fast_products(
+      std::vector<std::pair<element_index_type, element_index_type>> const&
+                                       pairs,
+      std::vector<element_index_type>& out) const {
+    for (auto const& x : pairs) {
+      validate_element_index(x.first);
+      validate_element_index(x.second);
+    }
+    out.resize(pairs.size());
+    size_t const c = fast_product_threshold();
+    for_each_block(pairs.size(), [this, &pairs, &out, c](size_t tid,
+                                                         size_t first,
+                                                         size_t last) {
+      // Cannot use _tmp_product itself since there are multiple threads here!
+      internal_element_type tmp_product = this->internal_copy(_tmp_product);
+      // The products found by following paths in the Cayley graphs are
+      // collected in idx, and traced together when there are
+      // trace_batch_size of them.
+      std::array<size_t, trace_batch_size> idx;
+      size_t                               n = 0;
+      for (size_t k = first; k < last; ++k) {
+        element_index_type const i = pairs[k].first;
+        element_index_type const j = pairs[k].second;
+        if (_length[i] < c || _length[j] < c) {
+          idx[n++] = k;
+          if (n == trace_batch_size) {
+            trace_products(pairs, out, idx.data(), n);
+            n = 0;
+          }
+        } else {
+          Product()(this->to_external(tmp_product),
+                    this->to_external_const(_elements[i]),
+                    this->to_external_const(_elements[j]),
+                    tid);
+          out[k] = map_find(tmp_product);
+        }
+      }
+      trace_products(pairs, out, idx.data(), n);
+      this->internal_free(tmp_product);
+    });
+  }
+
+  TEMPLATE FROIDURE_PIN& FROIDURE_PIN::calibrate() {
+    run();
+    detail::Timer timer;
+
+    // The sample consists of pairs of elements spread evenly through
+    // _enumerate_order, so that words of every length are included.
+    size_t const n = std::min(calibration_sample_size, size_t(_nr));
+    std::vector<std::pair<element_index_type, element_index_type>> sample;
+    size_t total_length = 0;
+    for (size_t k = 0; k < n; ++k) {
+      sample.emplace_back(_enumerate_order[(k * _nr) / n],
+                          _enumerate_order[((n - 1 - k) * _nr) / n]);
+      total_length += _length[sample.back().second];
+    }
+
+    // Returns the mean time in nanoseconds of a call to f, which is called
+    // repeatedly for at least a millisecond, so that the resolution of the
+    // clock does not matter. The return values of f are accumulated in the
+    // volatile sink, so that the calls cannot be optimised away.
+    size_t volatile sink    = 0;
+    auto            measure = [&sink](std::function<size_t()> const& f)
+        -> double {
+      std::chrono::nanoseconds const min_time(1000000);
+      detail::Timer                  t;
+      size_t                         nr_calls = 0;
+      do {
+        sink += f();
+        nr_calls++;
+      } while (t.elapsed() < min_time);
+      return static_cast<double>(t.elapsed().count()) / nr_calls;
+    };
+
+    // Multiply every pair in the sample, and find the product in _map.
+    double const product_find = measure([this, &sample]() -> size_t {
+      size_t out = 0;
+      for (auto const& p : sample) {
+        Product()(this->to_external(_tmp_product),
+                  this->to_external_const(_elements[p.first]),
+                  this->to_external_const(_elements[p.second]));
+        out += map_find(_tmp_product);
+      }
+      return out;
+    }) / n;
+    // Square every first entry, and compare the square to the element.
+    double const product_equal = measure([this, &sample]() -> size_t {
+      size_t out = 0;
+      for (auto const& p : sample) {
+        Product()(this->to_external(_tmp_product),
+                  this->to_external_const(_elements[p.first]),
+                  this->to_external_const(_elements[p.first]));
+        out += InternalEqualTo()(_tmp_product, _elements[p.first]);
+      }
+      return out;
+    }) / n;
+    // Follow the path in the right Cayley graph from every first entry
+    // labelled by the word for the second entry.
+    auto trace = [this, &sample]() -> size_t {
+      size_t out = 0;
+      for (auto const& p : sample) {
+        element_index_type i = p.first;
+        element_index_type j = p.second;
+        while (j != UNDEFINED) {
+          i = _right.get(i, _first[j]);
+          j = _suffix[j];
+        }
+        out += i;
+      }
+      return out;
+    };
+    double const step = std::max(measure(trace) / total_length, 1e-3);
+
+    _fast_product_threshold = std::max(
+        static_cast<size_t>(std::ceil(product_find / step)), size_t(1));
+    _idempotent_threshold = std::max(
+        static_cast<size_t>(product_equal / step), size_t(1));
+    REPORT_DEFAULT("product + find %.1fns, product + equal %.1fns, "
+                   "step %.1fns\n",
+                   product_find,
+                   product_equal,
+                   step);
+    REPORT_DEFAULT("thresholds are now %d (fast_product) and %d "
+                   "(idempotents)\n",
+                   _fast_product_threshold,
+                   _idempotent_threshold);
+    REPORT_TIME(timer);
+    return *this;
+  }
+
+  TEMPLATE FroidurePinStats FROIDURE_PIN::stats() const {
+    FroidurePinStats result;
+#ifdef LIBSEMIGROUPS_STATS
+    result.enabled               = true;
+    result.nr_hash_lookups       = _stats_hash_lookups.get();
+    result.nr_hash_probes        = _stats_hash_probes.get();
+    result.max_hash_probe_length = _stats_max_hash_probes.get();
+    result.nr_hash_comparisons   = _stats_hash_comparisons.get();
+    result.layers                = _stats_layers;
+    for (size_t i = 0; i < result.layers.size(); ++i) {
+      FroidurePinStats::Layer& layer = result.layers[i];
+      layer.length                   = i + 1;
+      if (i + 1 < _lenindex.size()) {
+        layer.nr_elements = _lenindex[i + 1] - _lenindex[i];
+      }
+      result.nr_products += layer.nr_products;
+      result.nr_products_avoided += layer.nr_products_avoided;
+    }
+#endif
+    return result;
+  }
+
   ELEMENT_INDEX_TYPE FROIDURE_PIN::letter_to_pos(letter_type i) const {
     validate_letter_index(i);
     return _letter_to_pos[i];
@@ -543,14 +760,12 @@ namespace libsemigroups {
     _final.reserve(nn);
     _first.reserve(nn);
     _enumerate_order.reserve(nn);
-    _left.reserve(nn);
+    if (!_left_lazy) {
+      _left.reserve(nn);
+    }
     _length.reserve(nn);
 
-    // #ifdef LIBSEMIGROUPS_DENSEHASHMAP
-    //    _map.resize(nn);
-    // #else
     _map.reserve(nn);
-    // #endif
 
     _prefix.reserve(nn);
     _reduced.reserve(nn);
@@ -573,9 +788,9 @@ namespace libsemigroups {
     }
 
     while (true) {
-      auto it = _map.find(this->to_internal_const(x));
-      if (it != _map.end()) {
-        return it->second;
+      element_index_type pos = map_find(this->to_internal_const(x));
+      if (pos != UNDEFINED) {
+        return pos;
       }
       if (finished()) {
         return UNDEFINED;
@@ -627,15 +842,31 @@ namespace libsemigroups {
 
   ELEMENT_INDEX_TYPE FROIDURE_PIN::left(element_index_type i, letter_type j) {
     run();
+    init_left();
     return _left.get(i, j);
   }
 
   CAYLEY_GRAPH_TYPE const& FROIDURE_PIN::left_cayley_graph() {
     run();
+    init_left();
     _left.shrink_rows_to(size());
     return _left;
   }
 
+  TEMPLATE FROIDURE_PIN& FROIDURE_PIN::lazy_left_cayley_graph(bool val) {
+    if (val && !_left_lazy) {
+      _left = cayley_graph_type(_nrgens);
+      _left_lazy = true;
+    } else if (!val) {
+      init_left();
+    }
+    return *this;
+  }
+
+  BOOL FROIDURE_PIN::lazy_left_cayley_graph() const noexcept {
+    return _left_lazy;
+  }
+
   VOID FROIDURE_PIN::minimal_factorisation(word_type&         word,
                                            element_index_type pos) {
     if (pos >= _nr && !finished()) {
@@ -695,25 +926,22 @@ namespace libsemigroups {
 
     if (_relation_pos != UNDEFINED) {
       while (_relation_pos < _nr) {
-        while (_relation_gen < _nrgens) {
-          if (!_reduced.get(_enumerate_order[_relation_pos], _relation_gen)
-              && (_relation_pos < _lenindex[1]
-                  || _reduced.get(_suffix[_enumerate_order[_relation_pos]],
-                                  _relation_gen))) {
-            relation.push_back(_enumerate_order[_relation_pos]);
-            relation.push_back(_relation_gen);
-            relation.push_back(
-                _right.get(_enumerate_order[_relation_pos], _relation_gen));
-            break;
-          }
-          _relation_gen++;
-        }
-        if (_relation_gen == _nrgens) {  // then relation is empty
-          _relation_gen = 0;
-          _relation_pos++;
-        } else {
+        // Find the least generator, not less than _relation_gen, such that
+        // the product of the element in position i and the generator is not
+        // reduced, but the product of the suffix of i and the generator is.
+        element_index_type const i = _enumerate_order[_relation_pos];
+        _relation_gen
+            = (_relation_pos < _lenindex[1]
+                   ? _reduced.next_unset(i, _relation_gen)
+                   : _reduced.next_difference(_suffix[i], i, _relation_gen));
+        if (_relation_gen < _nrgens) {
+          relation.push_back(i);
+          relation.push_back(_relation_gen);
+          relation.push_back(_right.get(i, _relation_gen));
           break;
         }
+        _relation_gen = 0;
+        _relation_pos++;
       }
       _relation_gen++;
     } else {
@@ -749,6 +977,7 @@ namespace libsemigroups {
     }
 
     detail::Timer timer;
+    detail::Timer layer_timer;
     size_t        tid = THREAD_ID_MANAGER.tid(std::this_thread::get_id());
 
     // product the generators by every generator
@@ -765,19 +994,20 @@ namespace libsemigroups {
 #ifdef LIBSEMIGROUPS_VERBOSE
           _nr_products++;
 #endif
-          auto it = _map.find(_tmp_product);
+          element_index_type pos = map_find(_tmp_product);
+          stats_product(pos == UNDEFINED);
 
-          if (it != _map.end()) {
-            _right.set(i, j, it->second);
+          if (pos != UNDEFINED) {
+            _right.set(i, j, pos);
             _nr_rules++;
           } else {
             is_one(_tmp_product, _nr);
-            _elements.push_back(this->internal_copy(_tmp_product));
+            _elements.push_back(_storage.copy(_tmp_product));
             _first.push_back(_first[i]);
             _final.push_back(j);
             _enumerate_order.push_back(_nr);
             _length.push_back(2);
-            _map.emplace(_elements.back(), _nr);
+            map_insert(_nr);
             _prefix.push_back(i);
             _reduced.set(i, j, true);
             _right.set(i, j, _nr);
@@ -787,31 +1017,52 @@ namespace libsemigroups {
         }
         _pos++;
       }
-      for (enumerate_index_type i = 0; i != _pos; ++i) {
-        letter_type b = _final[_enumerate_order[i]];
-        for (letter_type j = 0; j != _nrgens; ++j) {
-          _left.set(_enumerate_order[i], j, _right.get(_letter_to_pos[j], b));
+      if (!_left_lazy) {
+        for (enumerate_index_type i = 0; i != _pos; ++i) {
+          letter_type b = _final[_enumerate_order[i]];
+          for (letter_type j = 0; j != _nrgens; ++j) {
+            _left.set(
+                _enumerate_order[i], j, _right.get(_letter_to_pos[j], b));
+          }
         }
       }
+      stats_time(layer_timer);
       _wordlen++;
       expand(_nr - nr_shorter_elements);
       _lenindex.push_back(_enumerate_order.size());
+      if (!_checkpoint.empty()) {
+        write_checkpoint(_checkpoint);
+      }
+      if (_spill != nullptr) {
+        spill_elements(is_spillable());
+      }
     }
 
     // Multiply the words of length > 1 by every generator
     while (_pos != _nr && !stopped()) {
       size_type nr_shorter_elements = _nr;
+      if (max_threads() > 1 && current_size() >= concurrency_threshold()) {
+        while (_pos != _lenindex[_wordlen + 1] && !stopped()) {
+          enumerate_index_type last = _lenindex[_wordlen + 1];
+          if (last - _pos > batch_size()) {
+            last = _pos + std::max(batch_size(), size_t(1));
+          }
+          multiply_words_concurrently(last);
+        }
+      }
       while (_pos != _lenindex[_wordlen + 1] && !stopped()) {
         element_index_type i = _enumerate_order[_pos];
         letter_type        b = _first[i];
         element_index_type s = _suffix[i];
         for (letter_type j = 0; j != _nrgens; ++j) {
           if (!_reduced.get(s, j)) {
+            stats_product_avoided();
             element_index_type r = _right.get(s, j);
             if (_found_one && r == _pos_one) {
               _right.set(i, j, _letter_to_pos[b]);
             } else if (_prefix[r] != UNDEFINED) {  // r is not a generator
-              _right.set(i, j, _right.get(_left.get(_prefix[r], b), _final[r]));
+              _right.set(
+                  i, j, _right.get(left_product(_prefix[r], b), _final[r]));
             } else {
               _right.set(i, j, _right.get(_letter_to_pos[b], _final[r]));
             }
@@ -823,18 +1074,19 @@ namespace libsemigroups {
 #ifdef LIBSEMIGROUPS_VERBOSE
             _nr_products++;
 #endif
-            auto it = _map.find(_tmp_product);
+            element_index_type pos = map_find(_tmp_product);
+            stats_product(pos == UNDEFINED);
 
-            if (it != _map.end()) {
-              _right.set(i, j, it->second);
+            if (pos != UNDEFINED) {
+              _right.set(i, j, pos);
               _nr_rules++;
             } else {
               is_one(_tmp_product, _nr);
-              _elements.push_back(this->internal_copy(_tmp_product));
+              _elements.push_back(_storage.copy(_tmp_product));
               _first.push_back(b);
               _final.push_back(j);
               _length.push_back(_wordlen + 2);
-              _map.emplace(_elements.back(), _nr);
+              map_insert(_nr);
               _prefix.push_back(i);
               _reduced.set(i, j, true);
               _right.set(i, j, _nr);
@@ -847,17 +1099,27 @@ namespace libsemigroups {
         _pos++;
       }  // finished words of length <wordlen> + 1
       expand(_nr - nr_shorter_elements);
+      stats_time(layer_timer);
 
       if (_pos > _nr || _pos == _lenindex[_wordlen + 1]) {
-        for (enumerate_index_type i = _lenindex[_wordlen]; i != _pos; ++i) {
-          element_index_type p = _prefix[_enumerate_order[i]];
-          letter_type        b = _final[_enumerate_order[i]];
-          for (letter_type j = 0; j != _nrgens; ++j) {
-            _left.set(_enumerate_order[i], j, _right.get(_left.get(p, j), b));
+        if (!_left_lazy) {
+          for (enumerate_index_type i = _lenindex[_wordlen]; i != _pos; ++i) {
+            element_index_type p = _prefix[_enumerate_order[i]];
+            letter_type        b = _final[_enumerate_order[i]];
+            for (letter_type j = 0; j != _nrgens; ++j) {
+              _left.set(
+                  _enumerate_order[i], j, _right.get(_left.get(p, j), b));
+            }
           }
         }
         _wordlen++;
         _lenindex.push_back(_enumerate_order.size());
+        if (!_checkpoint.empty()) {
+          write_checkpoint(_checkpoint);
+        }
+        if (_spill != nullptr) {
+          spill_elements(is_spillable());
+        }
       }
       REPORT_DEFAULT("found %d elements, %d rules, %d max word length\n",
                      _nr,
@@ -922,11 +1184,11 @@ namespace libsemigroups {
 
     // add the new generators to new _gens, _elements, and _enumerate_order
     for (const_reference x : coll) {
-      auto it = _map.find(this->to_internal_const(x));
-      if (it == _map.end()) {  // new generator
-        _gens.push_back(this->internal_copy(this->to_internal_const(x)));
+      element_index_type pos = map_find(this->to_internal_const(x));
+      if (pos == UNDEFINED) {  // new generator
+        _gens.push_back(_storage.copy(this->to_internal_const(x)));
         _elements.push_back(_gens.back());
-        _map.emplace(_gens.back(), _nr);
+        map_insert(_nr);
 
         _first.push_back(_gens.size() - 1);
         _final.push_back(_gens.size() - 1);
@@ -939,27 +1201,32 @@ namespace libsemigroups {
         _suffix.push_back(UNDEFINED);
         _length.push_back(1);
         _nr++;
-      } else if (_letter_to_pos[_first[it->second]] == it->second) {
-        _gens.push_back(this->internal_copy(this->to_internal_const(x)));
+      } else if (_letter_to_pos[_first[pos]] == pos) {
+        _gens.push_back(_storage.copy(this->to_internal_const(x)));
         // x is one of the existing generators
         _duplicate_gens.push_back(
-            std::make_pair(_gens.size() - 1, _first[it->second]));
-        // _gens[_gens.size() - 1] = _gens[_first[it->second])]
+            std::make_pair(_gens.size() - 1, _first[pos]));
+        // _gens[_gens.size() - 1] = _gens[_first[pos])]
         // since _first maps element_index_type -> letter_type
-        _letter_to_pos.push_back(it->second);
+        _letter_to_pos.push_back(pos);
       } else {
         // x is an old element that will now be a generator
-        _gens.push_back(_elements[it->second]);
-        _letter_to_pos.push_back(it->second);
-        _enumerate_order.push_back(it->second);
+        if (pos < _nr_spilled) {
+          // Generators are never spilled, and so x is copied out of the
+          // spill file, which may be remapped or unmapped later.
+          _elements[pos] = _storage.copy(_elements[pos]);
+        }
+        _gens.push_back(_elements[pos]);
+        _letter_to_pos.push_back(pos);
+        _enumerate_order.push_back(pos);
 
-        _first[it->second]  = _gens.size() - 1;
-        _final[it->second]  = _gens.size() - 1;
-        _prefix[it->second] = UNDEFINED;
-        _suffix[it->second] = UNDEFINED;
-        _length[it->second] = UNDEFINED;
+        _first[pos]  = _gens.size() - 1;
+        _final[pos]  = _gens.size() - 1;
+        _prefix[pos] = UNDEFINED;
+        _suffix[pos] = UNDEFINED;
+        _length[pos] = UNDEFINED;
 
-        old_new[it->second] = true;
+        old_new[pos] = true;
       }
     }
 
@@ -974,13 +1241,14 @@ namespace libsemigroups {
     _lenindex.push_back(_nrgens - _duplicate_gens.size());
 
     // Add columns for new generators
-    _reduced = detail::DynamicArray2<bool>(
-        _nrgens, _reduced.nr_rows() + _nrgens - old_nrgens);
+    _reduced.reset(_nrgens, _reduced.nr_rows() + _nrgens - old_nrgens);
     _left.add_cols(_nrgens - _left.nr_cols());
     _right.add_cols(_nrgens - _right.nr_cols());
 
     // Add rows in for newly added generators
-    _left.add_rows(_nrgens - old_nrgens);
+    if (!_left_lazy) {
+      _left.add_rows(_nrgens - old_nrgens);
+    }
     _right.add_rows(_nrgens - old_nrgens);
 
     size_type nr_shorter_elements;
@@ -990,6 +1258,16 @@ namespace libsemigroups {
 
     while (nr_old_left > 0) {
       nr_shorter_elements = _nr;
+      if (max_threads() > 1 && current_size() >= concurrency_threshold()) {
+        while (_pos < _lenindex[_wordlen + 1] && nr_old_left > 0) {
+          enumerate_index_type last = _lenindex[_wordlen + 1];
+          if (last - _pos > batch_size()) {
+            last = _pos + std::max(batch_size(), size_t(1));
+          }
+          closure_update_concurrently(
+              last, old_nrgens, old_nr, nr_old_left, old_new);
+        }
+      }
       while (_pos < _lenindex[_wordlen + 1] && nr_old_left > 0) {
         element_index_type i = _enumerate_order[_pos];  // position in _elements
         letter_type        b = _first[i];
@@ -998,27 +1276,7 @@ namespace libsemigroups {
           nr_old_left--;
           // _elements[i] is in old semigroup, and its descendants are
           // known
-          for (letter_type j = 0; j < old_nrgens; j++) {
-            element_index_type k = _right.get(i, j);
-            if (!old_new[k]) {  // it's new!
-              is_one(_elements[k], k);
-              _first[k]  = _first[i];
-              _final[k]  = j;
-              _length[k] = _wordlen + 2;
-              _prefix[k] = i;
-              _reduced.set(i, j, true);
-              if (_wordlen == 0) {
-                _suffix[k] = _letter_to_pos[j];
-              } else {
-                _suffix[k] = _right.get(s, j);
-              }
-              _enumerate_order.push_back(k);
-              old_new[k] = true;
-            } else if (s == UNDEFINED || _reduced.get(s, j)) {
-              // this clause could be removed if _nr_rules wasn't necessary
-              _nr_rules++;
-            }
-          }
+          closure_update_old(i, s, old_nrgens, old_new);
           for (letter_type j = old_nrgens; j < _nrgens; j++) {
             closure_update(i, j, b, s, old_nr, tid, old_new);
           }
@@ -1034,7 +1292,9 @@ namespace libsemigroups {
 
       expand(_nr - nr_shorter_elements);
       if (_pos > _nr || _pos == _lenindex[_wordlen + 1]) {
-        if (_wordlen == 0) {
+        if (_left_lazy) {
+          // The left Cayley graph is computed by init_left if required
+        } else if (_wordlen == 0) {
           for (enumerate_index_type i = 0; i < _pos; i++) {
             size_t b = _final[_enumerate_order[i]];
             for (letter_type j = 0; j < _nrgens; j++) {
@@ -1138,6 +1398,309 @@ namespace libsemigroups {
     return tril::TRUE;
   }
 
+  ////////////////////////////////////////////////////////////////////////
+  // FroidurePin - checkpointing - public
+  ////////////////////////////////////////////////////////////////////////
+
+  VOID FROIDURE_PIN::save(std::string const& path) const {
+    std::lock_guard<std::mutex> lg(_mtx);
+    write_checkpoint(path);
+  }
+
+  VOID FROIDURE_PIN::load(std::string const& path) {
+    std::lock_guard<std::mutex> lg(_mtx);
+    std::ifstream               is(path, std::ios::binary);
+    if (!is) {
+      LIBSEMIGROUPS_EXCEPTION("cannot open %s for reading", path);
+    } else if (!detail::valid_checksum(is)) {
+      LIBSEMIGROUPS_EXCEPTION("%s is corrupt", path);
+    }
+
+    uint64_t magic, index_size;
+    detail::read_binary(is, magic);
+    detail::read_binary(is, index_size);
+    if (magic != detail::FROIDURE_PIN_CHECKPOINT_MAGIC
+        || index_size != sizeof(element_index_type)) {
+      LIBSEMIGROUPS_EXCEPTION("%s is not a FroidurePin checkpoint", path);
+    }
+
+    letter_type nrgens;
+    detail::read_binary(is, nrgens);
+    if (nrgens != _nrgens) {
+      LIBSEMIGROUPS_EXCEPTION("expected %d generators, found %d in %s",
+                              _nrgens,
+                              nrgens,
+                              path);
+    }
+    std::vector<size_t> hashes;
+    detail::read_binary(is, hashes);
+    if (hashes.size() != _nrgens) {
+      LIBSEMIGROUPS_EXCEPTION("%s is corrupt", path);
+    }
+    for (letter_type i = 0; i < _nrgens; ++i) {
+      if (hashes[i] != InternalHash()(_gens[i])) {
+        LIBSEMIGROUPS_EXCEPTION("generator %d is not the same as in %s",
+                                i,
+                                path);
+      }
+    }
+    size_t degree;
+    detail::read_binary(is, degree);
+    if (degree != _degree) {
+      LIBSEMIGROUPS_EXCEPTION(
+          "expected elements of degree %d, found %d in %s",
+          _degree,
+          degree,
+          path);
+    }
+
+    // Read everything before modifying this, so that this is unchanged if
+    // the file is corrupt.
+    size_type                                        nr;
+    enumerate_index_type                             pos;
+    size_t                                           wordlen, nr_rules;
+    bool                                             found_one;
+    element_index_type                               pos_one;
+    std::vector<std::pair<letter_type, letter_type>> duplicate_gens;
+    std::vector<element_index_type>                  letter_to_pos;
+    std::vector<enumerate_index_type>                lenindex;
+    std::vector<element_index_type>                  enumerate_order;
+    std::vector<letter_type>                         first, final;
+    std::vector<size_type>                           length;
+    std::vector<element_index_type>                  prefix, suffix;
+    detail::BitArray2                                reduced;
+    cayley_graph_type                                right(_nrgens);
+    cayley_graph_type                                left(_nrgens);
+    bool                                             left_lazy;
+
+    detail::read_binary(is, nr);
+    detail::read_binary(is, pos);
+    detail::read_binary(is, wordlen);
+    detail::read_binary(is, nr_rules);
+    detail::read_binary(is, found_one);
+    detail::read_binary(is, pos_one);
+    detail::read_binary(is, duplicate_gens);
+    detail::read_binary(is, letter_to_pos);
+    detail::read_binary(is, lenindex);
+    detail::read_binary(is, enumerate_order);
+    detail::read_binary(is, first);
+    detail::read_binary(is, final);
+    detail::read_binary(is, length);
+    detail::read_binary(is, prefix);
+    detail::read_binary(is, suffix);
+    detail::read_binary(is, reduced);
+    detail::read_binary(is, right);
+    detail::read_binary(is, left_lazy);
+    detail::read_binary(is, left);
+
+    if (letter_to_pos.size() != _nrgens || enumerate_order.size() > nr
+        || first.size() != nr || final.size() != nr || length.size() != nr
+        || prefix.size() != nr || suffix.size() != nr || right.nr_rows() < nr
+        || (!left_lazy && left.nr_rows() < nr) || reduced.nr_rows() < nr
+        || reduced.nr_cols() != _nrgens
+        || lenindex.size() < 2 || pos > nr) {
+      LIBSEMIGROUPS_EXCEPTION("%s is corrupt", path);
+    }
+
+    // Every value used as an index below must be in range. That the values
+    // are consistent with each other, for example that the Cayley graphs are
+    // those of the elements, is not checked; accidental corruption of the
+    // file is detected by the checksum instead. The lengths of the normal
+    // forms in _enumerate_order are non-decreasing, and _lenindex[i] is the
+    // position in _enumerate_order of the first word of length i + 1, so that
+    // _pos belongs to the block of words of length _wordlen + 1.
+    auto valid_index = [&nr](element_index_type i) -> bool {
+      return i < nr || i == UNDEFINED;
+    };
+    bool valid = wordlen + 1 < lenindex.size() && lenindex[0] == 0
+                 && lenindex.back() <= enumerate_order.size()
+                 && lenindex[wordlen] <= pos && pos <= lenindex[wordlen + 1]
+                 && (!found_one || pos_one < nr);
+    for (size_t i = 1; i < lenindex.size() && valid; ++i) {
+      valid = lenindex[i - 1] <= lenindex[i];
+    }
+    for (auto const& x : duplicate_gens) {
+      valid = valid && x.first < _nrgens && x.second < _nrgens;
+    }
+    for (element_index_type i : letter_to_pos) {
+      valid = valid && i < nr;
+    }
+    for (element_index_type i = 0; i < nr && valid; ++i) {
+      valid = first[i] < _nrgens && final[i] < _nrgens
+              && valid_index(prefix[i]) && valid_index(suffix[i])
+              && (prefix[i] == UNDEFINED) == (suffix[i] == UNDEFINED);
+      for (letter_type j = 0; j < _nrgens && valid; ++j) {
+        valid = valid_index(right.get(i, j))
+                && (left_lazy || valid_index(left.get(i, j)));
+      }
+    }
+    if (!valid) {
+      LIBSEMIGROUPS_EXCEPTION("%s is corrupt", path);
+    }
+    // The elements in the block of _enumerate_order starting at _lenindex[n]
+    // have length n + 1, and the prefix and suffix of an element of length
+    // n + 1 > 1 have length n. The length of an old element that became a
+    // generator in add_generators is UNDEFINED, and so the length of every
+    // element without a prefix is taken to be 1.
+    auto word_length = [&length, &prefix](element_index_type i) -> size_t {
+      return prefix[i] == UNDEFINED ? 1 : length[i];
+    };
+    size_t n = 0;
+    for (enumerate_index_type k = 0; k < enumerate_order.size(); ++k) {
+      while (n < lenindex.size() && lenindex[n] <= k) {
+        n++;
+      }
+      element_index_type const i = enumerate_order[k];
+      if (i >= nr || word_length(i) != n
+          || (n != 1
+              && (word_length(prefix[i]) != n - 1
+                  || word_length(suffix[i]) != n - 1
+                  || first[i] != first[prefix[i]]
+                  || final[i] != final[suffix[i]]))) {
+        LIBSEMIGROUPS_EXCEPTION("%s is corrupt", path);
+      }
+    }
+    // The elements in _enumerate_order before _pos have been multiplied by
+    // every generator, and so their rows in the right Cayley graph are
+    // complete, and the same holds for the left Cayley graph and the
+    // elements in the blocks of words of length at most _wordlen.
+    for (enumerate_index_type k = 0; k < pos; ++k) {
+      element_index_type const i = enumerate_order[k];
+      for (letter_type j = 0; j < _nrgens; ++j) {
+        if (right.get(i, j) == UNDEFINED
+            || (!left_lazy && k < lenindex[wordlen]
+                && left.get(i, j) == UNDEFINED)) {
+          LIBSEMIGROUPS_EXCEPTION("%s is corrupt", path);
+        }
+      }
+    }
+
+    // The elements are recomputed from their normal forms, and so the prefix
+    // of every element must be recomputed before it. The prefix of every
+    // element in _enumerate_order occurs before it in _enumerate_order.
+    // Elements not (yet) in _enumerate_order only occur after a call to
+    // add_generators, and their prefixes are elements from before that call
+    // and so have smaller index.
+    std::vector<element_index_type> order;
+    order.reserve(nr);
+    std::vector<bool> found(nr, false);
+    auto              visit = [&](element_index_type i) {
+      if (found[i] || (prefix[i] != UNDEFINED && !found[prefix[i]])) {
+        LIBSEMIGROUPS_EXCEPTION("%s is corrupt", path);
+      }
+      found[i] = true;
+      order.push_back(i);
+    };
+    for (element_index_type i : enumerate_order) {
+      visit(i);
+    }
+    for (element_index_type i = 0; i < nr; ++i) {
+      if (!found[i]) {
+        visit(i);
+      }
+    }
+
+    // Recompute the elements from their normal forms.
+    size_t tid = THREAD_ID_MANAGER.tid(std::this_thread::get_id());
+    std::vector<internal_element_type> elements(nr);
+    for (element_index_type i : order) {
+      if (prefix[i] == UNDEFINED) {
+        elements[i] = _storage.copy(_gens[first[i]]);
+      } else {
+        Product()(this->to_external(_tmp_product),
+                  this->to_external_const(elements[prefix[i]]),
+                  this->to_external_const(_gens[final[i]]),
+                  tid);
+        elements[i] = _storage.copy(_tmp_product);
+      }
+    }
+
+    // Replace the data of this by that from the file.
+    free_elements();
+    _gens.clear();
+    _shared.reset();
+    _nr_shared = 0;
+    if (_spill != nullptr) {
+      std::string const spill_path = _spill->path();
+      _spill.reset();
+      _spill.reset(new detail::SpillFile(spill_path));
+    }
+    _nr_spilled = 0;
+
+    _nr        = nr;
+    _pos       = pos;
+    _wordlen   = wordlen;
+    _nr_rules  = nr_rules;
+    _found_one = found_one;
+    _pos_one   = pos_one;
+    _duplicate_gens  = std::move(duplicate_gens);
+    _letter_to_pos   = std::move(letter_to_pos);
+    _lenindex        = std::move(lenindex);
+    _enumerate_order = std::move(enumerate_order);
+    _first           = std::move(first);
+    _final           = std::move(final);
+    _length          = std::move(length);
+    _prefix          = std::move(prefix);
+    _suffix          = std::move(suffix);
+    _elements        = std::move(elements);
+    _reduced         = std::move(reduced);
+    _right           = std::move(right);
+    _left            = std::move(left);
+    _left_lazy       = left_lazy;
+    copy_gens();
+
+    _map.clear();
+    _map.reserve(_nr);
+    for (element_index_type i = 0; i < _nr; ++i) {
+      map_insert(i);
+    }
+
+    _idempotents.clear();
+    _idempotents_found = false;
+    _is_idempotent.clear();
+    _sorted.clear();
+    _relation_pos = UNDEFINED;
+    _relation_gen = 0;
+  }
+
+  TEMPLATE FROIDURE_PIN& FROIDURE_PIN::checkpoint(std::string const& path) {
+    _checkpoint = path;
+    return *this;
+  }
+
+  TEMPLATE std::string const& FROIDURE_PIN::checkpoint() const noexcept {
+    return _checkpoint;
+  }
+
+  ////////////////////////////////////////////////////////////////////////
+  // FroidurePin - spilling - public
+  ////////////////////////////////////////////////////////////////////////
+
+  TEMPLATE FROIDURE_PIN& FROIDURE_PIN::spill(std::string const& path) {
+    std::lock_guard<std::mutex> lg(_mtx);
+    if (!path.empty()) {
+      if (!is_spillable::value) {
+        LIBSEMIGROUPS_EXCEPTION("cannot spill elements, the element type must "
+                                "be trivially copyable and stored by pointer");
+      } else if (_nr_shared != 0) {
+        LIBSEMIGROUPS_EXCEPTION("cannot spill elements that are shared with "
+                                "a copy of the FroidurePin instance");
+      }
+    }
+    unspill_elements();
+    _spill.reset();
+    if (!path.empty()) {
+      _spill.reset(new detail::SpillFile(path));
+      spill_elements(is_spillable());
+    }
+    return *this;
+  }
+
+  TEMPLATE std::string const& FROIDURE_PIN::spill() const noexcept {
+    static std::string const none;
+    return _spill == nullptr ? none : _spill->path();
+  }
+
   ////////////////////////////////////////////////////////////////////////
   // FroidurePin - validation member functions - private
   ////////////////////////////////////////////////////////////////////////
@@ -1166,7 +1729,9 @@ namespace libsemigroups {
 
   // Expand the data structures in the semigroup with space for nr elements
   INLINE_VOID FROIDURE_PIN::expand(size_type nr) {
-    _left.add_rows(nr);
+    if (!_left_lazy) {
+      _left.add_rows(nr);
+    }
     _reduced.add_rows(nr);
     _right.add_rows(nr);
   }
@@ -1185,6 +1750,201 @@ namespace libsemigroups {
     }
   }
 
+  // Returns the position of x in _elements, or UNDEFINED if x is not one of
+  // the elements found so far. This does not modify anything, and so can be
+  // called by several threads at once.
+  ELEMENT_INDEX_TYPE FROIDURE_PIN::map_find(
+      internal_const_element_type x) const {
+#ifdef LIBSEMIGROUPS_STATS
+    size_t             nr_probes      = 0;
+    size_t             nr_comparisons = 0;
+    element_index_type pos            = _map.find(
+        InternalHash()(x),
+        [this, &x, &nr_comparisons](element_index_type i) {
+          nr_comparisons++;
+          return InternalEqualTo()(_elements[i], x);
+        },
+        nr_probes);
+    _stats_hash_lookups.add(1);
+    _stats_hash_probes.add(nr_probes);
+    _stats_max_hash_probes.max(nr_probes);
+    _stats_hash_comparisons.add(nr_comparisons);
+    return pos;
+#else
+    return _map.find(InternalHash()(x), [this, &x](element_index_type i) {
+      return InternalEqualTo()(_elements[i], x);
+    });
+#endif
+  }
+
+  // Add the element in position pos of _elements to _map.
+  INLINE_VOID FROIDURE_PIN::map_insert(element_index_type pos) {
+    LIBSEMIGROUPS_ASSERT(pos < _elements.size());
+    _map.insert(InternalHash()(_elements[pos]), pos);
+  }
+
+  INLINE_VOID FROIDURE_PIN::stats_product(bool is_new) {
+#ifdef LIBSEMIGROUPS_STATS
+    if (_stats_layers.size() <= _wordlen) {
+      _stats_layers.resize(_wordlen + 1);
+    }
+    _stats_layers[_wordlen].nr_products++;
+    if (is_new) {
+      _stats_layers[_wordlen].nr_new++;
+    } else {
+      _stats_layers[_wordlen].nr_duplicates++;
+    }
+#else
+    (void) is_new;
+#endif
+  }
+
+  INLINE_VOID FROIDURE_PIN::stats_product_avoided() {
+#ifdef LIBSEMIGROUPS_STATS
+    if (_stats_layers.size() <= _wordlen) {
+      _stats_layers.resize(_wordlen + 1);
+    }
+    _stats_layers[_wordlen].nr_products_avoided++;
+#endif
+  }
+
+  // Add the time since timer was reset to the current layer, and reset it.
+  INLINE_VOID FROIDURE_PIN::stats_time(detail::Timer& timer) {
+#ifdef LIBSEMIGROUPS_STATS
+    if (_stats_layers.size() <= _wordlen) {
+      _stats_layers.resize(_wordlen + 1);
+    }
+    _stats_layers[_wordlen].time += timer.elapsed();
+    timer.reset();
+#else
+    (void) timer;
+#endif
+  }
+
+  // Returns the position of the product of the generator with index b and the
+  // element in position i. If the left Cayley graph is not being computed
+  // during enumeration, then this is found by tracing the minimal word for i
+  // in the right Cayley graph starting at the generator, and so the right
+  // Cayley graph must be known for every proper left factor of b * i.
+  TEMPLATE inline element_index_type
+  FROIDURE_PIN::left_product(element_index_type i, letter_type b) const {
+    if (!_left_lazy) {
+      return _left.get(i, b);
+    }
+    element_index_type x = _letter_to_pos[b];
+    while (i != UNDEFINED) {
+      x = _right.get(x, _first[i]);
+      i = _suffix[i];
+    }
+    return x;
+  }
+
+  // Transfer the ownership of those elements of this that are not already
+  // shared, and of the storage that they were allocated by, to a new
+  // shared_elements_type, so that copies of this can share them rather than
+  // copying them. The elements themselves are not moved, and this uses a new
+  // (empty) storage for any elements found later. Elements stored by value
+  // are not shared, since copying them is no more expensive than copying
+  // pointers to them.
+  VOID FROIDURE_PIN::share_elements() const {
+    if (!std::is_pointer<internal_element_type>::value) {
+      return;
+    }
+    std::lock_guard<std::mutex> lg(_mtx);
+    if (_nr_shared != _elements.size()) {
+      _shared = std::make_shared<shared_elements_type>(_shared,
+                                                       std::move(_storage),
+                                                       _elements.cbegin()
+                                                           + _nr_shared,
+                                                       _elements.cend());
+      _nr_shared = _elements.size();
+    }
+  }
+
+  // Free the elements of this that are not shared, and the copies of the
+  // duplicate generators, which are not in _elements.
+  VOID FROIDURE_PIN::free_elements() {
+    for (auto& x : _duplicate_gens) {
+      _storage.free(_gens[x.first]);
+    }
+    for (size_t i = _nr_shared; i < _elements.size(); ++i) {
+      if (i >= _nr_spilled || _prefix[i] == UNDEFINED) {
+        _storage.free(_elements[i]);
+      }
+    }
+  }
+
+  // Write the elements that have not yet been spilled, and that are not
+  // multiplied by the generators again, to the spill file, free them, and
+  // point _elements at their copies in the file. This only applies to those
+  // elements whose index equals their position in _enumerate_order (which is
+  // every element unless add_generators has been called), so that the
+  // spilled elements are those with index less than _nr_spilled. The
+  // generators are written to the file too, but are not freed, since they
+  // are also in _gens. _mtx must be locked by the caller.
+  VOID FROIDURE_PIN::spill_elements(std::true_type) {
+    size_type last = _nr_spilled;
+    while (last < _pos && _enumerate_order[last] == last) {
+      ++last;
+    }
+    if (last == _nr_spilled) {
+      return;
+    }
+    LIBSEMIGROUPS_ASSERT(_spill->size() == _nr_spilled * sizeof(element_type));
+    size_t constexpr batch_size = (size_t(1) << 20) / sizeof(element_type) + 1;
+    std::vector<char> buf;
+    buf.reserve(std::min(batch_size, static_cast<size_t>(last - _nr_spilled))
+                * sizeof(element_type));
+    for (size_type i = _nr_spilled; i < last; ++i) {
+      char const* x = reinterpret_cast<char const*>(_elements[i]);
+      buf.insert(buf.end(), x, x + sizeof(element_type));
+      if (buf.size() == batch_size * sizeof(element_type)) {
+        _spill->write(buf.data(), buf.size());
+        buf.clear();
+      }
+    }
+    _spill->write(buf.data(), buf.size());
+    _spill->map();
+
+    // The mapping may have moved, and so every spilled element is repointed.
+    for (size_type i = 0; i < last; ++i) {
+      if (_prefix[i] != UNDEFINED) {
+        if (i >= _nr_spilled) {
+          _storage.free(_elements[i]);
+        }
+        // The mapping is read-only, but the elements are never modified.
+        _elements[i] = reinterpret_cast<internal_element_type>(
+            const_cast<char*>(_spill->data()) + i * sizeof(element_type));
+      }
+    }
+    _nr_spilled = last;
+    repoint_sorted_and_idempotents();
+  }
+
+  // Copy the spilled elements back into memory, the spill file is left
+  // unchanged.
+  VOID FROIDURE_PIN::unspill_elements() {
+    for (size_type i = 0; i < _nr_spilled; ++i) {
+      if (_prefix[i] != UNDEFINED) {
+        _elements[i] = _storage.copy(_elements[i]);
+      }
+    }
+    _nr_spilled = 0;
+    repoint_sorted_and_idempotents();
+  }
+
+  // _sorted and _idempotents contain copies of the pointers in _elements,
+  // which are changed when elements are spilled or unspilled.
+  VOID FROIDURE_PIN::repoint_sorted_and_idempotents() {
+    // _sorted[i].second is the position of _elements[i] in _sorted.
+    for (size_t i = 0; i < _sorted.size(); ++i) {
+      _sorted[_sorted[i].second].first = _elements[i];
+    }
+    for (auto& x : _idempotents) {
+      x.first = _elements[x.second];
+    }
+  }
+
   // _nrgens, _duplicates_gens, _letter_to_pos, and _elements must all be
   // initialised for this to work, and _gens must point to an empty vector.
   VOID FROIDURE_PIN::copy_gens() {
@@ -1196,7 +1956,7 @@ namespace libsemigroups {
       // The degree of everything in _elements has already been increased (if
       // it needs to be at all), and so we do not need to increase the degree
       // in the copy below.
-      _gens[x.first] = this->internal_copy(_elements[_letter_to_pos[x.second]]);
+      _gens[x.first] = _storage.copy(_elements[_letter_to_pos[x.second]]);
       seen[x.first]  = true;
     }
     // the non-duplicate gens are already in _elements, so don't really copy
@@ -1207,6 +1967,54 @@ namespace libsemigroups {
     }
   }
 
+  // Writes the checkpoint file, _mtx must be locked by the caller.
+  VOID FROIDURE_PIN::write_checkpoint(std::string const& path) const {
+    std::string const tmp = path + ".tmp";
+    {
+      std::ofstream os(tmp, std::ios::binary | std::ios::trunc);
+      if (!os) {
+        LIBSEMIGROUPS_EXCEPTION("cannot open %s for writing", tmp);
+      }
+      uint64_t const      magic      = detail::FROIDURE_PIN_CHECKPOINT_MAGIC;
+      uint64_t const      index_size = sizeof(element_index_type);
+      std::vector<size_t> hashes;
+      for (auto const& x : _gens) {
+        hashes.push_back(InternalHash()(x));
+      }
+      detail::write_binary(os, magic);
+      detail::write_binary(os, index_size);
+      detail::write_binary(os, _nrgens);
+      detail::write_binary(os, hashes);
+      detail::write_binary(os, _degree);
+      detail::write_binary(os, _nr);
+      detail::write_binary(os, _pos);
+      detail::write_binary(os, _wordlen);
+      detail::write_binary(os, _nr_rules);
+      detail::write_binary(os, _found_one);
+      detail::write_binary(os, _pos_one);
+      detail::write_binary(os, _duplicate_gens);
+      detail::write_binary(os, _letter_to_pos);
+      detail::write_binary(os, _lenindex);
+      detail::write_binary(os, _enumerate_order);
+      detail::write_binary(os, _first);
+      detail::write_binary(os, _final);
+      detail::write_binary(os, _length);
+      detail::write_binary(os, _prefix);
+      detail::write_binary(os, _suffix);
+      detail::write_binary(os, _reduced);
+      detail::write_binary(os, _right);
+      detail::write_binary(os, _left_lazy);
+      detail::write_binary(os, _left);
+      if (!os.flush()) {
+        LIBSEMIGROUPS_EXCEPTION("cannot write to %s", tmp);
+      }
+    }
+    detail::write_checksum(tmp);
+    if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+      LIBSEMIGROUPS_EXCEPTION("cannot rename %s to %s", tmp, path);
+    }
+  }
+
   VOID FROIDURE_PIN::closure_update(element_index_type i,
                                     letter_type        j,
                                     letter_type        b,
@@ -1219,7 +2027,7 @@ namespace libsemigroups {
       if (_found_one && r == _pos_one) {
         _right.set(i, j, _letter_to_pos[b]);
       } else if (_prefix[r] != UNDEFINED) {
-        _right.set(i, j, _right.get(_left.get(_prefix[r], b), _final[r]));
+        _right.set(i, j, _right.get(left_product(_prefix[r], b), _final[r]));
       } else {
         _right.set(i, j, _right.get(_letter_to_pos[b], _final[r]));
       }
@@ -1228,14 +2036,14 @@ namespace libsemigroups {
                 this->to_external_const(_elements[i]),
                 this->to_external_const(_gens[j]),
                 tid);
-      auto it = _map.find(_tmp_product);
-      if (it == _map.end()) {  // it's new!
+      element_index_type pos = map_find(_tmp_product);
+      if (pos == UNDEFINED) {  // it's new!
         is_one(_tmp_product, _nr);
-        _elements.push_back(this->internal_copy(_tmp_product));
+        _elements.push_back(_storage.copy(_tmp_product));
         _first.push_back(b);
         _final.push_back(j);
         _length.push_back(_wordlen + 2);
-        _map.emplace(_elements.back(), _nr);
+        map_insert(_nr);
         _prefix.push_back(i);
         _reduced.set(i, j, true);
         _right.set(i, j, _nr);
@@ -1246,34 +2054,500 @@ namespace libsemigroups {
         }
         _enumerate_order.push_back(_nr);
         _nr++;
-      } else if (it->second < old_nr && !old_new[it->second]) {
+      } else if (pos < old_nr && !old_new[pos]) {
         // we didn't process it yet!
-        is_one(_tmp_product, it->second);
-        _first[it->second]  = b;
-        _final[it->second]  = j;
-        _length[it->second] = _wordlen + 2;
-        _prefix[it->second] = i;
+        is_one(_tmp_product, pos);
+        _first[pos]  = b;
+        _final[pos]  = j;
+        _length[pos] = _wordlen + 2;
+        _prefix[pos] = i;
         _reduced.set(i, j, true);
-        _right.set(i, j, it->second);
+        _right.set(i, j, pos);
         if (_wordlen == 0) {
-          _suffix[it->second] = _letter_to_pos[j];
+          _suffix[pos] = _letter_to_pos[j];
         } else {
-          _suffix[it->second] = _right.get(s, j);
+          _suffix[pos] = _right.get(s, j);
         }
-        _enumerate_order.push_back(it->second);
-        old_new[it->second] = true;
-      } else {  // it->second >= old->_nr || old_new[it->second]
+        _enumerate_order.push_back(pos);
+        old_new[pos] = true;
+      } else {  // pos >= old->_nr || old_new[pos]
         // it's old
-        _right.set(i, j, it->second);
+        _right.set(i, j, pos);
         _nr_rules++;
       }
     }
   }
 
+  // Update the data structure for the products of the element in position i
+  // of _elements, which belonged to the semigroup before add_generators was
+  // called and whose row in _right is known, by the first old_nrgens
+  // generators. These products are already known, but they might not have
+  // been seen yet since add_generators was called.
+  VOID FROIDURE_PIN::closure_update_old(element_index_type i,
+                                        element_index_type s,
+                                        letter_type        old_nrgens,
+                                        std::vector<bool>& old_new) {
+    for (letter_type j = 0; j < old_nrgens; j++) {
+      element_index_type k = _right.get(i, j);
+      if (!old_new[k]) {  // it's new!
+        is_one(_elements[k], k);
+        _first[k]  = _first[i];
+        _final[k]  = j;
+        _length[k] = _wordlen + 2;
+        _prefix[k] = i;
+        _reduced.set(i, j, true);
+        if (_wordlen == 0) {
+          _suffix[k] = _letter_to_pos[j];
+        } else {
+          _suffix[k] = _right.get(s, j);
+        }
+        _enumerate_order.push_back(k);
+        old_new[k] = true;
+      } else if (s == UNDEFINED || _reduced.get(s, j)) {
+        // this clause could be removed if _nr_rules wasn't necessary
+        _nr_rules++;
+      }
+    }
+  }
+
+  // Process the words in positions [_pos, last) of _enumerate_order, which
+  // must all have the same length, in add_generators. This does exactly the
+  // same thing as the loop in add_generators, but in the same two phases as
+  // multiply_words_concurrently, so that the positions of the elements do not
+  // depend on the number of threads used. If nr_old_left is reached before
+  // last, then the remaining words are not processed, as in add_generators.
+  VOID FROIDURE_PIN::closure_update_concurrently(enumerate_index_type last,
+                                                 letter_type old_nrgens,
+                                                 size_type   old_nr,
+                                                 size_type&  nr_old_left,
+                                                 std::vector<bool>& old_new) {
+    LIBSEMIGROUPS_ASSERT(_pos < last && last <= _lenindex[_wordlen + 1]);
+    LIBSEMIGROUPS_ASSERT(nr_old_left > 0);
+    // The rows of _right of the words in [_pos, last) are not modified until
+    // the words themselves are processed, and so we can find in advance the
+    // word after which add_generators would stop.
+    size_type n = 0;
+    for (enumerate_index_type pos = _pos; pos < last; ++pos) {
+      if (_right.get(_enumerate_order[pos], 0) != UNDEFINED
+          && ++n == nr_old_left) {
+        last = pos + 1;
+        break;
+      }
+    }
+    size_t const nr_words = last - _pos;
+    // See multiply_words_concurrently for the layout of found and prods.
+    std::vector<element_index_type>    found(nr_words * _nrgens,
+                                          element_index_type(UNDEFINED));
+    std::vector<internal_element_type> prods(nr_words * _nrgens);
+    products_concurrently(last, old_nrgens, found, prods);
+
+    for (size_t k = 0; _pos != last; ++_pos, ++k) {
+      element_index_type i  = _enumerate_order[_pos];
+      letter_type        b  = _first[i];
+      element_index_type s  = _suffix[i];
+      letter_type        j0 = 0;
+      if (_right.get(i, 0) != UNDEFINED) {
+        nr_old_left--;
+        closure_update_old(i, s, old_nrgens, old_new);
+        j0 = old_nrgens;
+      }
+      for (letter_type j = j0; j < _nrgens; ++j) {
+        if (_wordlen != 0 && !_reduced.get(s, j)) {
+          element_index_type r = _right.get(s, j);
+          if (_found_one && r == _pos_one) {
+            _right.set(i, j, _letter_to_pos[b]);
+          } else if (_prefix[r] != UNDEFINED) {
+            _right.set(
+                i, j, _right.get(left_product(_prefix[r], b), _final[r]));
+          } else {
+            _right.set(i, j, _right.get(_letter_to_pos[b], _final[r]));
+          }
+          continue;
+        }
+        size_t const       idx = k * _nrgens + j;
+        element_index_type pos = found[idx];
+        if (pos == UNDEFINED) {
+          // The product was not in _map in phase 1, but it might have been
+          // added since by an earlier word in [_pos, last).
+          pos = map_find(prods[idx]);
+          if (pos != UNDEFINED) {
+            this->internal_free(prods[idx]);
+          }
+        }
+        if (pos == UNDEFINED) {  // it's new!
+          is_one(prods[idx], _nr);
+          _elements.push_back(_storage.adopt(prods[idx]));
+          _first.push_back(b);
+          _final.push_back(j);
+          _length.push_back(_wordlen + 2);
+          map_insert(_nr);
+          _prefix.push_back(i);
+          _reduced.set(i, j, true);
+          _right.set(i, j, _nr);
+          if (_wordlen == 0) {
+            _suffix.push_back(_letter_to_pos[j]);
+          } else {
+            _suffix.push_back(_right.get(s, j));
+          }
+          _enumerate_order.push_back(_nr);
+          _nr++;
+        } else if (pos < old_nr && !old_new[pos]) {
+          // we didn't process it yet!
+          is_one(_elements[pos], pos);
+          _first[pos]  = b;
+          _final[pos]  = j;
+          _length[pos] = _wordlen + 2;
+          _prefix[pos] = i;
+          _reduced.set(i, j, true);
+          _right.set(i, j, pos);
+          if (_wordlen == 0) {
+            _suffix[pos] = _letter_to_pos[j];
+          } else {
+            _suffix[pos] = _right.get(s, j);
+          }
+          _enumerate_order.push_back(pos);
+          old_new[pos] = true;
+        } else {  // pos >= old->_nr || old_new[pos]
+          // it's old
+          _right.set(i, j, pos);
+          _nr_rules++;
+        }
+      }
+    }
+  }
+
+  // Multiply the words in positions [_pos, last) of _enumerate_order, which
+  // must all have the same length (at least 2), by every generator. This does
+  // exactly the same thing as the main loop in run_impl, but in two phases:
+  //
+  // 1. the products that cannot be determined from the Cayley graph are
+  //    computed by up to max_threads() threads, and looked up in _map, which
+  //    is not modified during this phase;
+  //
+  // 2. the results are merged into the data structure by a single thread in
+  //    the same order as the single-threaded algorithm, so that the positions
+  //    of the elements do not depend on the number of threads used.
+  VOID FROIDURE_PIN::multiply_words_concurrently(enumerate_index_type last) {
+    LIBSEMIGROUPS_ASSERT(_wordlen > 0);
+    LIBSEMIGROUPS_ASSERT(_pos < last && last <= _lenindex[_wordlen + 1]);
+    size_t const nr_words = last - _pos;
+    // The product of the word in position _pos + k of _enumerate_order and
+    // the generator j is stored in position k * _nrgens + j of found and
+    // prods.
+    std::vector<element_index_type>    found(nr_words * _nrgens,
+                                          element_index_type(UNDEFINED));
+    std::vector<internal_element_type> prods(nr_words * _nrgens);
+    products_concurrently(last, 0, found, prods);
+
+    for (size_t k = 0; _pos != last; ++_pos, ++k) {
+      element_index_type i = _enumerate_order[_pos];
+      letter_type        b = _first[i];
+      element_index_type s = _suffix[i];
+      for (letter_type j = 0; j != _nrgens; ++j) {
+        if (!_reduced.get(s, j)) {
+          stats_product_avoided();
+          element_index_type r = _right.get(s, j);
+          if (_found_one && r == _pos_one) {
+            _right.set(i, j, _letter_to_pos[b]);
+          } else if (_prefix[r] != UNDEFINED) {  // r is not a generator
+            _right.set(
+                i, j, _right.get(left_product(_prefix[r], b), _final[r]));
+          } else {
+            _right.set(i, j, _right.get(_letter_to_pos[b], _final[r]));
+          }
+          continue;
+        }
+#ifdef LIBSEMIGROUPS_VERBOSE
+        _nr_products++;
+#endif
+        size_t const       idx = k * _nrgens + j;
+        element_index_type pos = found[idx];
+        if (pos == UNDEFINED) {
+          // The product was not in _map in phase 1, but it might have been
+          // added since by an earlier word in [_pos, last).
+          pos = map_find(prods[idx]);
+          if (pos != UNDEFINED) {
+            this->internal_free(prods[idx]);
+          }
+        }
+        stats_product(pos == UNDEFINED);
+        if (pos != UNDEFINED) {
+          _right.set(i, j, pos);
+          _nr_rules++;
+        } else {
+          is_one(prods[idx], _nr);
+          _elements.push_back(_storage.adopt(prods[idx]));
+          _first.push_back(b);
+          _final.push_back(j);
+          _length.push_back(_wordlen + 2);
+          map_insert(_nr);
+          _prefix.push_back(i);
+          _reduced.set(i, j, true);
+          _right.set(i, j, _nr);
+          _suffix.push_back(_right.get(s, j));
+          _enumerate_order.push_back(_nr);
+          _nr++;
+        }
+      }
+    }
+  }
+
+  // Returns the least length of a path in the Cayley graph for which
+  // multiplying two elements and finding the product in _map is quicker than
+  // following the path, as measured by calibrate, or estimated from
+  // Complexity if calibrate has not been called.
+  TEMPLATE inline size_t FROIDURE_PIN::fast_product_threshold() const {
+    if (_fast_product_threshold != UNDEFINED) {
+      return _fast_product_threshold;
+    }
+    return 2 * Complexity()(this->to_external_const(_tmp_product));
+  }
+
+  // Returns the greatest length of a word for which following the path in
+  // the Cayley graph labelled by the word from the element it represents is
+  // quicker than squaring the element and comparing the square to it.
+  TEMPLATE inline size_t FROIDURE_PIN::idempotent_threshold() const {
+    if (_idempotent_threshold != UNDEFINED) {
+      return _idempotent_threshold;
+    }
+    return std::max(
+        size_t{Complexity()(this->to_external_const(_tmp_product)) / 2},
+        size_t{1});
+  }
+
+  // Find the positions of the words in positions [first, last) of words,
+  // which must all be valid. The words are traced in the right Cayley graph
+  // trace_batch_size at a time, one letter of every word in turn, and the
+  // row of _right required by the next letter of each word is prefetched, so
+  // that the memory accesses for different words overlap.
+  VOID FROIDURE_PIN::trace_words(std::vector<word_type> const&    words,
+                                 std::vector<element_index_type>& out,
+                                 size_t const                     first,
+                                 size_t const last) const {
+    for (size_t k = first; k < last; k += trace_batch_size) {
+      size_t const end     = std::min(last, k + trace_batch_size);
+      size_t       max_len = 0;
+      for (size_t l = k; l < end; ++l) {
+        out[l] = _letter_to_pos[words[l][0]];
+        _right.prefetch_row(out[l]);
+        max_len = std::max(max_len, words[l].size());
+      }
+      for (size_t m = 1; m < max_len; ++m) {
+        for (size_t l = k; l < end; ++l) {
+          if (m < words[l].size() && out[l] != UNDEFINED) {
+            out[l] = _right.get(out[l], words[l][m]);
+            if (out[l] != UNDEFINED) {
+              _right.prefetch_row(out[l]);
+            }
+          }
+        }
+      }
+    }
+  }
+
+  // Find the positions of the products of the pairs in positions idx[0],
+  // ..., idx[n - 1] of pairs, where n is at most trace_batch_size, in the
+  // same way as product_by_reduction. The paths for the different products are
+  // followed one step of each in turn, as in trace_words.
+  VOID FROIDURE_PIN::trace_products(
+      std::vector<std::pair<element_index_type, element_index_type>> const&
+                                       pairs,
+      std::vector<element_index_type>& out,
+      size_t const*                    idx,
+      size_t const                     n) const {
+    LIBSEMIGROUPS_ASSERT(n <= trace_batch_size);
+    // If use_left[l], then the path in the left Cayley graph from j[l]
+    // labelled by the reverse of the word for i[l] is followed, otherwise the
+    // path in the right Cayley graph from i[l] labelled by the word for j[l].
+    std::array<element_index_type, trace_batch_size> i, j;
+    std::array<bool, trace_batch_size>               use_left;
+    size_t                                           nr_active = n;
+    for (size_t l = 0; l < n; ++l) {
+      i[l]        = pairs[idx[l]].first;
+      j[l]        = pairs[idx[l]].second;
+      use_left[l] = !_left_lazy && _length[i[l]] <= _length[j[l]];
+    }
+    while (nr_active > 0) {
+      nr_active = 0;
+      for (size_t l = 0; l < n; ++l) {
+        if (use_left[l] && i[l] != UNDEFINED) {
+          j[l] = _left.get(j[l], _final[i[l]]);
+          i[l] = _prefix[i[l]];
+          if (j[l] != UNDEFINED) {
+            _left.prefetch_row(j[l]);
+          }
+          nr_active++;
+        } else if (!use_left[l] && j[l] != UNDEFINED) {
+          i[l] = _right.get(i[l], _first[j[l]]);
+          j[l] = _suffix[j[l]];
+          if (i[l] != UNDEFINED) {
+            _right.prefetch_row(i[l]);
+          }
+          nr_active++;
+        }
+      }
+    }
+    for (size_t l = 0; l < n; ++l) {
+      out[idx[l]] = (use_left[l] ? j[l] : i[l]);
+    }
+  }
+
+  // Call f(t, first, last) for a partition of [0, n) into blocks [first,
+  // last), one block for each of up to max_threads() threads, where t is the
+  // index of the block, and the thread id to use for products in the block.
+  // THREAD_ID_MANAGER is not reset here, since this is called by const member
+  // functions which can be called from several threads at the same time.
+  TEMPLATE
+  template <typename TFunction>
+  void FROIDURE_PIN::for_each_block(size_t const n, TFunction&& f) const {
+    size_t const N
+        = (n < concurrency_threshold() ? 1 : std::min(max_threads(), n));
+    if (N <= 1) {
+      f(0, 0, n);
+      return;
+    }
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < N; ++t) {
+      threads.emplace_back(f, t, (t * n) / N, ((t + 1) * n) / N);
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  }
+
+  // Phase 1 of multiply_words_concurrently and closure_update_concurrently:
+  // divide the words in positions [_pos, last) of _enumerate_order between
+  // up to max_threads() threads, each of which calls products_by_generators.
+  VOID FROIDURE_PIN::products_concurrently(
+      enumerate_index_type const          last,
+      letter_type const                   old_nrgens,
+      std::vector<element_index_type>&    found,
+      std::vector<internal_element_type>& prods) const {
+    size_t const nr_words = last - _pos;
+    size_t const N        = std::min(max_threads(), nr_words);
+    if (N > 1) {
+      std::vector<std::thread> threads;
+      THREAD_ID_MANAGER.reset();
+      size_t const len = nr_words / N;
+      for (size_t t = 0; t < N; ++t) {
+        threads.emplace_back(&FroidurePin::products_by_generators,
+                             this,
+                             _pos + t * len,
+                             (t == N - 1 ? last : _pos + (t + 1) * len),
+                             old_nrgens,
+                             std::ref(found),
+                             std::ref(prods));
+      }
+      for (auto& thread : threads) {
+        thread.join();
+      }
+    } else {
+      products_by_generators(_pos, last, old_nrgens, found, prods);
+    }
+  }
+
+  // Compute the products of the words in positions [first, last) of
+  // _enumerate_order by those generators where the product cannot be
+  // determined using the Cayley graph, and find them in _map. If a product
+  // belongs to _map, then its position is stored in found, otherwise a copy
+  // of the product is stored in prods. The products of the words whose row
+  // in _right is already known (which only happens in add_generators) by the
+  // first old_nrgens generators are not required. This member function is
+  // called by several threads at once, and so it must not modify the data
+  // structure.
+  VOID FROIDURE_PIN::products_by_generators(
+      enumerate_index_type const          first,
+      enumerate_index_type const          last,
+      letter_type const                   old_nrgens,
+      std::vector<element_index_type>&    found,
+      std::vector<internal_element_type>& prods) const {
+    // Cannot use _tmp_product itself since there are multiple threads here!
+    internal_element_type tmp_product = this->internal_copy(_tmp_product);
+    size_t tid = THREAD_ID_MANAGER.tid(std::this_thread::get_id());
+
+    for (enumerate_index_type pos = first; pos < last; ++pos) {
+      element_index_type i   = _enumerate_order[pos];
+      element_index_type s   = _suffix[i];
+      size_t const       idx = (pos - _pos) * _nrgens;
+      letter_type const  j0
+          = (old_nrgens != 0 && _right.get(i, 0) != UNDEFINED ? old_nrgens
+                                                               : 0);
+      for (letter_type j = j0; j != _nrgens; ++j) {
+        if (s == UNDEFINED || _reduced.get(s, j)) {
+          Product()(this->to_external(tmp_product),
+                    this->to_external_const(_elements[i]),
+                    this->to_external_const(_gens[j]),
+                    tid);
+          element_index_type const k = map_find(tmp_product);
+          if (k != UNDEFINED) {
+            found[idx + j] = k;
+          } else {
+            prods[idx + j] = this->internal_copy(tmp_product);
+          }
+        }
+      }
+    }
+    this->internal_free(tmp_product);
+  }
+
   ////////////////////////////////////////////////////////////////////////
   // FroidurePin - initialisation member functions - private
   ////////////////////////////////////////////////////////////////////////
 
+  // Compute the left Cayley graph of the elements in every word length that
+  // has been completely enumerated, if it was not computed during
+  // enumeration. The left multiples of the elements of a given length only
+  // depend on those of the shorter elements, and so the elements of each
+  // length are divided between max_threads() threads.
+  VOID FROIDURE_PIN::init_left() {
+    if (!_left_lazy) {
+      return;
+    }
+    detail::Timer timer;
+    _left.add_rows(_right.nr_rows() - _left.nr_rows());
+    size_t const N = (current_size() < concurrency_threshold()
+                          ? 1
+                          : max_threads());
+    for (size_t k = 0; k < _wordlen; ++k) {
+      enumerate_index_type const first = _lenindex[k];
+      enumerate_index_type const last  = _lenindex[k + 1];
+      size_t const n = std::min(N, static_cast<size_t>(last - first));
+      if (n <= 1) {
+        init_left_layer(first, last);
+      } else {
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < n; ++i) {
+          threads.emplace_back(&FroidurePin::init_left_layer,
+                               this,
+                               first + (i * (last - first)) / n,
+                               first + ((i + 1) * (last - first)) / n);
+        }
+        for (auto& thread : threads) {
+          thread.join();
+        }
+      }
+    }
+    _left_lazy = false;
+    REPORT_TIME(timer);
+  }
+
+  // Compute the left multiples of the elements in positions [first, last) of
+  // _enumerate_order, the left multiples of their prefixes must be known.
+  VOID FROIDURE_PIN::init_left_layer(enumerate_index_type const first,
+                                     enumerate_index_type const last) {
+    for (enumerate_index_type i = first; i < last; ++i) {
+      element_index_type const p = _prefix[_enumerate_order[i]];
+      letter_type const        b = _final[_enumerate_order[i]];
+      for (letter_type j = 0; j < _nrgens; ++j) {
+        _left.set(_enumerate_order[i],
+                  j,
+                  _right.get(p == UNDEFINED ? _letter_to_pos[j]
+                                            : _left.get(p, j),
+                             b));
+      }
+    }
+  }
+
   // Initialise the data member _sorted. We store a list of pairs consisting
   // of an internal_element_type and element_index_type which is sorted on the
   // first entry using the operator< of the Element class. The second
@@ -1284,11 +2558,14 @@ namespace libsemigroups {
       return;
     }
     size_t n = size();
+    detail::Timer timer;
     _sorted.reserve(n);
     for (element_index_type i = 0; i < n; i++) {
       _sorted.emplace_back(_elements[i], i);
     }
-    std::sort(
+    size_t const N
+        = (n < concurrency_threshold() ? 1 : std::min(max_threads(), n));
+    detail::parallel_sort(
         _sorted.begin(),
         _sorted.end(),
         [this](std::pair<internal_element_type, element_index_type> const& x,
@@ -1296,17 +2573,43 @@ namespace libsemigroups {
             -> bool {
           return Less()(this->to_external_const(x.first),
                         this->to_external_const(y.first));
-        });
-
-    // Invert the permutation in _sorted[*].second
-    std::vector<element_index_type> tmp_inverter;
-    tmp_inverter.resize(n);
-    for (element_index_type i = 0; i < n; i++) {
-      tmp_inverter[_sorted[i].second] = i;
-    }
-    for (element_index_type i = 0; i < n; i++) {
-      _sorted[i].second = tmp_inverter[i];
+        },
+        N);
+
+    // Invert the permutation in _sorted[*].second, every thread inverts the
+    // entries in a block of positions, and different blocks write to
+    // different entries of tmp_inverter.
+    std::vector<element_index_type> tmp_inverter(n);
+    auto invert = [this, &tmp_inverter](size_t first, size_t last) {
+      for (size_t i = first; i < last; i++) {
+        tmp_inverter[_sorted[i].second] = i;
+      }
+    };
+    auto copy_back = [this, &tmp_inverter](size_t first, size_t last) {
+      for (size_t i = first; i < last; i++) {
+        _sorted[i].second = tmp_inverter[i];
+      }
+    };
+    if (N == 1) {
+      invert(0, n);
+      copy_back(0, n);
+    } else {
+      std::vector<std::thread> threads;
+      for (size_t i = 0; i < N; ++i) {
+        threads.emplace_back(invert, (i * n) / N, ((i + 1) * n) / N);
+      }
+      for (auto& thread : threads) {
+        thread.join();
+      }
+      threads.clear();
+      for (size_t i = 0; i < N; ++i) {
+        threads.emplace_back(copy_back, (i * n) / N, ((i + 1) * n) / N);
+      }
+      for (auto& thread : threads) {
+        thread.join();
+      }
     }
+    REPORT_TIME(timer);
   }
 
   // Find the idempotents and store their pointers and positions in a
@@ -1324,9 +2627,7 @@ namespace libsemigroups {
     // Find the threshold beyond which it is quicker to simply product
     // elements rather than follow a path in the Cayley graph. This is the
     // enumerate_index_t i for which length(i) >= complexity.
-    size_t cmplxty = std::max(
-        size_t{Complexity()(this->to_external_const(_tmp_product)) / 2},
-        size_t{1});
+    size_t cmplxty = idempotent_threshold();
     LIBSEMIGROUPS_ASSERT(_lenindex.size() > 1);
     // threshold_length = the min. length of a word which is >= complexity.
     // if a word has length strictly greater than threshold_length, then we
@@ -1359,134 +2660,107 @@ namespace libsemigroups {
     REPORT_VERBOSE_DEFAULT(
         "number of products %*s = %llu\n", 21, " ", _nr - threshold_index);
 
-    // _lenindex.at(threshold_length) is the element_index_type where words of
-    // length (threshold_length + 1) begin
-    LIBSEMIGROUPS_ASSERT(_nr >= _lenindex.at(threshold_length));
-    total_load += cmplxty * (_nr - _lenindex.at(threshold_length));
-    size_t const N = max_threads();
+    // is_idem[k] is set to true by the threads if k is an idempotent, the
+    // type is uint8_t and not bool so that different threads can write to
+    // adjacent entries.
+    std::vector<uint8_t> is_idem(_nr, false);
+    std::atomic<size_t>  next(0);
+    size_t const         N = max_threads();
     LIBSEMIGROUPS_ASSERT(N != 0);
 
     if (N == 1 || size() < concurrency_threshold()) {
       // Use only 1 thread
-      idempotents(0, _nr, threshold_index, _idempotents);
+      idempotents(next, threshold_index, is_idem);
     } else {
-      // Use > 1 threads
-      size_t                            mean_load = total_load / N;
-      size_t                            len       = 1;
-      std::vector<enumerate_index_type> first(N, 0);
-      std::vector<enumerate_index_type> last(N, _nr);
-      std::vector<std::vector<internal_idempotent_pair>> tmp(
-          N, std::vector<internal_idempotent_pair>());
+      // Use > 1 threads, every thread takes blocks of indices from next until
+      // there are none left, so that the threads finish at (approximately)
+      // the same time regardless of how long each block takes.
       std::vector<std::thread> threads;
       THREAD_ID_MANAGER.reset();
-
-      for (size_t i = 0; i < N - 1; i++) {
-        size_t thread_load = 0;
-        last[i]            = first[i];
-        while (thread_load < mean_load && last[i] < threshold_index) {
-          if (last[i] >= _lenindex[len]) {
-            ++len;
-          }
-          thread_load += len;
-          ++last[i];
-        }
-        while (thread_load < mean_load) {
-          thread_load += cmplxty;
-          ++last[i];
-        }
-        total_load -= thread_load;
-        REPORT_DEFAULT("thread %d has load %d\n", i + 1, thread_load);
-        first[i + 1] = last[i];
-
+      for (size_t i = 0; i < N; ++i) {
         threads.emplace_back(&FroidurePin::idempotents,
                              this,
-                             first[i],
-                             last[i],
+                             std::ref(next),
                              threshold_index,
-                             std::ref(tmp[i]));
-      }
-
-      REPORT_DEFAULT("thread %d has load %d\n", N, total_load);
-      threads.emplace_back(&FroidurePin::idempotents,
-                           this,
-                           first[N - 1],
-                           last[N - 1],
-                           threshold_index,
-                           std::ref(tmp[N - 1]));
-
-      size_t nr_idempotents = 0;
-      for (size_t i = 0; i < N; i++) {
-        threads[i].join();
-        nr_idempotents += tmp[i].size();
+                             std::ref(is_idem));
       }
-      _idempotents.reserve(nr_idempotents);
-      for (size_t i = 0; i < N; i++) {
-        std::copy(
-            tmp[i].begin(), tmp[i].end(), std::back_inserter(_idempotents));
+      for (auto& thread : threads) {
+        thread.join();
       }
     }
-    REPORT_TIME(timer);
-  }
 
-  // Find the idempotents in the range [first, last) and store
-  // the corresponding std::pair of type internal_idempotent_pair in the 4th
-  // parameter. The parameter threshold is the point, calculated in
-  // init_idempotents, at which it is better to simply product elements
-  // rather than trace in the left/right Cayley graph.
-  VOID FROIDURE_PIN::idempotents(
-      enumerate_index_type const             first,
-      enumerate_index_type const             last,
-      enumerate_index_type const             threshold,
-      std::vector<internal_idempotent_pair>& idempotents) {
-    REPORT_DEFAULT(
-        "first = %d, last = %d, diff = %d\n", first, last, last - first);
-    detail::Timer timer;
-
-    enumerate_index_type pos = first;
-
-    for (; pos < std::min(threshold, last); pos++) {
+    // Collect the idempotents in the order they were enumerated.
+    for (enumerate_index_type pos = 0; pos < _nr; ++pos) {
       element_index_type k = _enumerate_order[pos];
-      if (!_is_idempotent[k]) {
-        // The following is product_by_reduction, don't have to consider
-        // lengths because they are equal!!
-        element_index_type i = k, j = k;
-        while (j != UNDEFINED) {
-          i = _right.get(i, _first[j]);
-          // TODO(later) improve this if R/L-classes are known to stop
-          // performing the product if we fall out of the R/L-class of the
-          // initial element.
-          j = _suffix[j];
-        }
-        if (i == k) {
-          idempotents.emplace_back(_elements[k], k);
-          _is_idempotent[k] = true;
-        }
+      if (is_idem[k]) {
+        _idempotents.emplace_back(_elements[k], k);
+        _is_idempotent[k] = true;
       }
     }
+    REPORT_TIME(timer);
+  }
 
-    if (pos >= last) {
-      REPORT_TIME(timer);
-      return;
-    }
+  // Find the idempotents in blocks of positions in _enumerate_order obtained
+  // from the shared counter next, until there are no blocks left, and set
+  // is_idem[k] to true for every idempotent k found. The parameter threshold
+  // is the point, calculated in init_idempotents, at which it is better to
+  // simply product elements rather than trace in the left/right Cayley graph.
+  VOID FROIDURE_PIN::idempotents(std::atomic<size_t>&       next,
+                                 enumerate_index_type const threshold,
+                                 std::vector<uint8_t>&      is_idem) {
+    // Small enough that the blocks are shared evenly between the threads,
+    // large enough that the threads rarely contend for next.
+    size_t const  block_size = 512;
+    size_t        nr_blocks  = 0;
+    detail::Timer timer;
 
     // Cannot use _tmp_product itself since there are multiple threads here!
     internal_element_type tmp_product = this->internal_copy(_tmp_product);
     size_t tid = THREAD_ID_MANAGER.tid(std::this_thread::get_id());
 
-    for (; pos < last; pos++) {
-      element_index_type k = _enumerate_order[pos];
-      if (!_is_idempotent[k]) {
-        Product()(this->to_external(tmp_product),
-                  this->to_external(_elements[k]),
-                  this->to_external(_elements[k]),
-                  tid);
-        if (InternalEqualTo()(tmp_product, _elements[k])) {
-          idempotents.emplace_back(_elements[k], k);
-          _is_idempotent[k] = true;
+    size_t first = next.fetch_add(block_size);
+    while (first < _nr) {
+      nr_blocks++;
+      enumerate_index_type const last
+          = std::min(first + block_size, static_cast<size_t>(_nr));
+      enumerate_index_type pos = first;
+
+      for (; pos < std::min(threshold, last); pos++) {
+        element_index_type k = _enumerate_order[pos];
+        if (!_is_idempotent[k]) {
+          // The following is product_by_reduction, don't have to consider
+          // lengths because they are equal!!
+          element_index_type i = k, j = k;
+          while (j != UNDEFINED) {
+            i = _right.get(i, _first[j]);
+            // TODO(later) improve this if R/L-classes are known to stop
+            // performing the product if we fall out of the R/L-class of the
+            // initial element.
+            j = _suffix[j];
+          }
+          if (i == k) {
+            is_idem[k] = true;
+          }
         }
       }
+
+      for (; pos < last; pos++) {
+        element_index_type k = _enumerate_order[pos];
+        if (!_is_idempotent[k]) {
+          Product()(this->to_external(tmp_product),
+                    this->to_external(_elements[k]),
+                    this->to_external(_elements[k]),
+                    tid);
+          if (InternalEqualTo()(tmp_product, _elements[k])) {
+            is_idem[k] = true;
+          }
+        }
+      }
+      first = next.fetch_add(block_size);
     }
     this->internal_free(tmp_product);
+    REPORT_DEFAULT(
+        "processed %d blocks of %d elements\n", nr_blocks, block_size);
     REPORT_TIME(timer);
   }
 
@@ -0,0 +1,226 @@
+//
+// libsemigroups - C++ library for semigroups and monoids
+// Copyright (C) 2019 James D. Mitchell
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+// This file contains the declaration of the class FroidurePinView, which
+// provides read-only access to the Cayley graphs and normal forms of a fully
+// enumerated FroidurePin, stored in a memory-mapped file.
+
+#ifndef LIBSEMIGROUPS_INCLUDE_FROIDURE_PIN_VIEW_HPP_
+#define LIBSEMIGROUPS_INCLUDE_FROIDURE_PIN_VIEW_HPP_
+
+#include <cstddef>  // for size_t
+#include <cstdint>  // for uint64_t
+#include <string>   // for string
+
+#include "froidure-pin-base.hpp"  // for FroidurePinBase
+#include "types.hpp"              // for letter_type, word_type
+
+namespace libsemigroups {
+  //! Defined in ``froidure-pin-view.hpp``.
+  //!
+  //! A FroidurePinView is a read-only view of the combinatorial data (the
+  //! left and right Cayley graphs, and the minimal factorisations) of a fully
+  //! enumerated FroidurePin. This data is written to a file by
+  //! FroidurePinView::save, and the file is memory-mapped by the constructor
+  //! of FroidurePinView. Neither the elements nor the hash map of the
+  //! original FroidurePin are reconstructed, and so constructing a
+  //! FroidurePinView is almost instantaneous. Since the file is mapped
+  //! read-only, many processes can use the same file at once, and the
+  //! operating system only keeps a single copy of it in memory.
+  //!
+  //! The member functions of FroidurePinView have the same meaning as those
+  //! of FroidurePin with the same name.
+  //!
+  //! The file format is not portable between platforms with different
+  //! endianness or sizes of FroidurePinBase::element_index_type, and a
+  //! FroidurePinView can only read files written by a version of
+  //! libsemigroups configured with the same \c --enable-compact-index
+  //! option.
+  //!
+  //! \sa FroidurePin and FroidurePinBase.
+  class FroidurePinView final {
+   public:
+    //! Type for the position of an element in a FroidurePinView.
+    using element_index_type = FroidurePinBase::element_index_type;
+
+    //! Writes the data required by FroidurePinView to a file.
+    //!
+    //! This function fully enumerates \p S, and then writes its left and
+    //! right Cayley graphs, and the data defining its minimal factorisations,
+    //! to the file \p path. The file is first written to \p path with the
+    //! suffix \c ".tmp" and then renamed, so that \p path is never left
+    //! partially written.
+    //!
+    //! \param S the FroidurePin to write.
+    //! \param path the name of the file to write.
+    //!
+    //! \returns
+    //! (None).
+    //!
+    //! \throws LibsemigroupsException if the file cannot be written.
+    //!
+    //! \complexity
+    //! Linear in the size of \p S times the number of generators of \p S,
+    //! once \p S is fully enumerated.
+    static void save(FroidurePinBase& S, std::string const& path);
+
+    //! Memory-maps a file written by FroidurePinView::save.
+    //!
+    //! \param path the name of the file to map.
+    //!
+    //! \throws LibsemigroupsException if the file cannot be opened or mapped,
+    //! or was not written by FroidurePinView::save.
+    //!
+    //! \complexity
+    //! Constant.
+    explicit FroidurePinView(std::string const& path);
+
+    //! Default constructor - deleted.
+    FroidurePinView() = delete;
+
+    //! Move constructor.
+    //!
+    //! \exceptions
+    //! \noexcept
+    FroidurePinView(FroidurePinView&&) noexcept;
+
+    //! Copy constructor - deleted.
+    FroidurePinView(FroidurePinView const&) = delete;
+
+    //! Copy assignment operator - deleted.
+    FroidurePinView& operator=(FroidurePinView const&) = delete;
+
+    //! Move assignment operator - deleted.
+    FroidurePinView& operator=(FroidurePinView&&) = delete;
+
+    ~FroidurePinView();
+
+    //! Returns the size of the semigroup.
+    //!
+    //! \exceptions
+    //! \noexcept
+    size_t size() const noexcept {
+      return _header->_size;
+    }
+
+    //! Returns the number of generators of the semigroup.
+    //!
+    //! \exceptions
+    //! \noexcept
+    size_t nr_generators() const noexcept {
+      return _header->_nr_generators;
+    }
+
+    //! Returns the total number of relations in the presentation defining
+    //! the semigroup.
+    //!
+    //! \exceptions
+    //! \noexcept
+    size_t nr_rules() const noexcept {
+      return _header->_nr_rules;
+    }
+
+    //! Returns the maximum length of a word in the generators so far
+    //! computed.
+    //!
+    //! \exceptions
+    //! \noexcept
+    size_t max_word_length() const noexcept {
+      return _header->_max_word_length;
+    }
+
+    //! \copydoc FroidurePin::letter_to_pos
+    element_index_type letter_to_pos(letter_type) const;
+
+    //! \copydoc FroidurePin::right(element_index_type, letter_type)
+    element_index_type right(element_index_type, letter_type) const;
+
+    //! \copydoc FroidurePin::left(element_index_type, letter_type)
+    element_index_type left(element_index_type, letter_type) const;
+
+    //! \copydoc FroidurePin::prefix
+    element_index_type prefix(element_index_type) const;
+
+    //! \copydoc FroidurePin::suffix
+    element_index_type suffix(element_index_type) const;
+
+    //! \copydoc FroidurePin::first_letter
+    letter_type first_letter(element_index_type) const;
+
+    //! \copydoc FroidurePin::final_letter
+    letter_type final_letter(element_index_type) const;
+
+    //! \copydoc FroidurePin::length_const
+    size_t length(element_index_type) const;
+
+    //! \copydoc FroidurePin::word_to_pos
+    element_index_type word_to_pos(word_type const&) const;
+
+    //! \copydoc FroidurePin::product_by_reduction
+    element_index_type product_by_reduction(element_index_type,
+                                            element_index_type) const;
+
+    //! Returns the position of the product of the elements in positions
+    //! \p i and \p j, this is the same as
+    //! FroidurePinView::product_by_reduction since the elements themselves
+    //! are not available.
+    element_index_type fast_product(element_index_type i,
+                                    element_index_type j) const {
+      return product_by_reduction(i, j);
+    }
+
+    //! Changes \p word in-place to contain a minimal word with respect to the
+    //! short-lex ordering in the generators equal to the element in position
+    //! \p pos.
+    //!
+    //! \throws LibsemigroupsException if \p pos is out of range.
+    void minimal_factorisation(word_type& word, element_index_type pos) const;
+
+    //! Returns a minimal word with respect to the short-lex ordering in the
+    //! generators equal to the element in position \p pos.
+    //!
+    //! \throws LibsemigroupsException if \p pos is out of range.
+    word_type minimal_factorisation(element_index_type pos) const;
+
+   private:
+    struct Header {
+      uint64_t _magic;
+      uint64_t _index_size;
+      uint64_t _nr_generators;
+      uint64_t _size;
+      uint64_t _nr_rules;
+      uint64_t _max_word_length;
+    };
+
+    void validate_element_index(element_index_type) const;
+    void validate_letter_index(letter_type) const;
+
+    size_t                    _bytes;
+    void*                     _data;
+    element_index_type const* _final;
+    element_index_type const* _first;
+    Header const*             _header;
+    element_index_type const* _left;
+    element_index_type const* _length;
+    element_index_type const* _letter_to_pos;
+    element_index_type const* _prefix;
+    element_index_type const* _right;
+    element_index_type const* _suffix;
+  };
+}  // namespace libsemigroups
+#endif  // LIBSEMIGROUPS_INCLUDE_FROIDURE_PIN_VIEW_HPP_
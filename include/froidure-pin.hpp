@@ -23,30 +23,161 @@
 #ifndef LIBSEMIGROUPS_INCLUDE_FROIDURE_PIN_HPP_
 #define LIBSEMIGROUPS_INCLUDE_FROIDURE_PIN_HPP_
 
+#include <atomic>         // for atomic
 #include <cstddef>        // for size_t
+#include <cstdint>        // for uint8_t, uint64_t
 #include <iterator>       // for reverse_iterator
+#include <memory>         // for shared_ptr
 #include <mutex>          // for mutex
+#include <string>         // for string
+#include <thread>         // for thread
 #include <type_traits>    // for is_const, remove_pointer
-#include <unordered_map>  // for unordered_map
 #include <utility>        // for pair
 #include <vector>         // for vector
 
 #include "adapters.hpp"           // for Complexity, Degree, IncreaseDegree
 #include "bruidhinn-traits.hpp"   // for detail::BruidhinnTraits
 #include "constants.hpp"          // for libsemigroups::UNDEFINED, LIMIT_MAX
-#include "containers.hpp"         // for DynamicArray2
+#include "containers.hpp"         // for DynamicArray2, FlatHashIndex
 #include "froidure-pin-base.hpp"  // for FroidurePinBase, FroidurePinBase::s...
 #include "iterator.hpp"           // for ConstIteratorStateless
-// #include "libsemigroups-config.hpp"  // for LIBSEMIGROUPS_DENSEHASHMAP
-#include "stl.hpp"    // for EqualTo, Hash
-#include "types.hpp"  // for letter_type, word_type
-
-// #ifdef LIBSEMIGROUPS_DENSEHASHMAP
-// #include "extern/sparsehash-c11/sparsehash/dense_hash_map"
-// #endif
+#include "spill-file.hpp"         // for SpillFile
+#include "stl.hpp"                // for EqualTo, Hash, MakeVoid
+#include "timer.hpp"              // for Timer
+#include "types.hpp"              // for letter_type, word_type
 
 //! Namespace for everything in the libsemigroups library.
 namespace libsemigroups {
+  namespace detail {
+    // The first 8 bytes of every file written by FroidurePin::save.
+    constexpr uint64_t FROIDURE_PIN_CHECKPOINT_MAGIC = 0x4c53474650434b31;
+
+    // Storage policy for FroidurePin where every element is allocated
+    // separately, using detail::BruidhinnTraits::internal_copy.
+    template <typename TElementType>
+    class FroidurePinHeapStorage final
+        : private detail::BruidhinnTraits<TElementType> {
+      using internal_value_type =
+          typename detail::BruidhinnTraits<TElementType>::internal_value_type;
+      using internal_const_reference = typename detail::BruidhinnTraits<
+          TElementType>::internal_const_reference;
+
+     public:
+      // Returns a copy of x that is freed by FroidurePinHeapStorage::free.
+      internal_value_type copy(internal_const_reference x) {
+        return this->internal_copy(x);
+      }
+
+      // Takes ownership of x, which was returned by internal_copy.
+      internal_value_type adopt(internal_value_type x) {
+        return x;
+      }
+
+      void free(internal_value_type x) {
+        this->internal_free(x);
+      }
+    };
+
+    // Storage policy for FroidurePin where the elements are copied into a
+    // detail::Arena, so that they are contiguous in memory in the order they
+    // are found, and no memory is allocated per element. This only applies
+    // to element types that are stored by pointer (i.e. not small and
+    // trivial), and which are trivially copyable, so that their size is fixed
+    // at compile time.
+    template <typename TElementType>
+    class FroidurePinArenaStorage final
+        : private detail::BruidhinnTraits<TElementType> {
+      using value_type =
+          typename detail::BruidhinnTraits<TElementType>::value_type;
+      using internal_value_type =
+          typename detail::BruidhinnTraits<TElementType>::internal_value_type;
+      using internal_const_reference = typename detail::BruidhinnTraits<
+          TElementType>::internal_const_reference;
+
+      static_assert(std::is_same<internal_value_type, value_type*>::value,
+                    "the elements must be stored by pointer");
+
+     public:
+      FroidurePinArenaStorage() : _arena() {}
+
+      // Returns a copy of x that belongs to the arena, and is freed when
+      // this is destroyed.
+      internal_value_type copy(internal_const_reference x) {
+        return _arena.copy(*x);
+      }
+
+      // Takes ownership of x, which was returned by internal_copy.
+      internal_value_type adopt(internal_value_type x) {
+        internal_value_type y = _arena.copy(*x);
+        this->internal_free(x);
+        return y;
+      }
+
+      // The memory of x is only released when every element in the same
+      // block of the arena has been freed.
+      void free(internal_value_type x) {
+        _arena.free(x);
+      }
+
+     private:
+      detail::Arena<value_type> _arena;
+    };
+
+    // The elements in a contiguous range of positions of a FroidurePin
+    // instance, which are shared read-only by that instance and its copies,
+    // and are freed, together with the storage that they were allocated by,
+    // when the last instance sharing them is destroyed. The elements in the
+    // earlier positions belong to the parent.
+    template <typename TElementType, typename TStorage>
+    class FroidurePinSharedElements final {
+      using internal_value_type =
+          typename detail::BruidhinnTraits<TElementType>::internal_value_type;
+      using const_iterator =
+          typename std::vector<internal_value_type>::const_iterator;
+
+     public:
+      FroidurePinSharedElements(
+          std::shared_ptr<FroidurePinSharedElements const> parent,
+          TStorage&&                                       storage,
+          const_iterator                                   first,
+          const_iterator                                   last)
+          : _elements(first, last),
+            _parent(std::move(parent)),
+            _storage(std::move(storage)) {}
+
+      FroidurePinSharedElements(FroidurePinSharedElements const&) = delete;
+      FroidurePinSharedElements& operator=(FroidurePinSharedElements const&)
+          = delete;
+
+      ~FroidurePinSharedElements() {
+        for (auto& x : _elements) {
+          _storage.free(x);
+        }
+      }
+
+     private:
+      std::vector<internal_value_type>                 _elements;
+      std::shared_ptr<FroidurePinSharedElements const> _parent;
+      TStorage                                         _storage;
+    };
+
+    // The storage policy of a FroidurePin with traits class TTraits: this is
+    // TTraits::Storage if it exists, and FroidurePinHeapStorage otherwise, so
+    // that traits classes without a member Storage can still be used.
+    template <typename TElementType, typename TTraits, typename = void>
+    struct FroidurePinStorage {
+      using type = FroidurePinHeapStorage<TElementType>;
+    };
+
+    template <typename TElementType, typename TTraits>
+    struct FroidurePinStorage<
+        TElementType,
+        TTraits,
+        typename MakeVoid<typename TTraits::Storage>::type> {
+      using type = typename TTraits::Storage;
+    };
+  }  // namespace detail
+
 
   //! Defined in ``froidure-pin.hpp``.
   //!
@@ -89,6 +220,24 @@ namespace libsemigroups {
 
     //! \copydoc libsemigroups::Swap
     using Swap = ::libsemigroups::Swap<element_type>;
+
+    //! The type used to allocate the elements of a FroidurePin instance.
+    //!
+    //! If \p TElementType is not a pointer, not small enough to be stored by
+    //! value, and is trivially copyable, then the elements are copied into
+    //! large contiguous blocks of memory in the order they are found. Otherwise
+    //! every element is allocated separately.
+    //!
+    //! A traits class for FroidurePin that does not derive from
+    //! FroidurePinTraits is not required to have this member, and if it does
+    //! not, then every element is allocated separately.
+    using Storage = typename std::conditional<
+        !std::is_pointer<TElementType>::value
+            && std::is_pointer<typename detail::BruidhinnTraits<
+                TElementType>::internal_value_type>::value
+            && std::is_trivially_copyable<element_type>::value,
+        detail::FroidurePinArenaStorage<TElementType>,
+        detail::FroidurePinHeapStorage<TElementType>>::type;
   };
 
   //! Defined in ``froidure-pin.hpp``.
@@ -250,6 +399,13 @@ namespace libsemigroups {
     //! \copydoc libsemigroups::Swap
     using Swap = typename TTraits::Swap;
 
+    //! \copydoc FroidurePinTraits::Storage
+    //!
+    //! If \p TTraits has no member \c Storage, then every element is
+    //! allocated separately.
+    using Storage =
+        typename detail::FroidurePinStorage<TElementType, TTraits>::type;
+
    private:
     struct InternalEqualTo : private detail::BruidhinnTraits<TElementType> {
       bool operator()(internal_const_reference x,
@@ -319,6 +475,16 @@ namespace libsemigroups {
     //! Constructs a new FroidurePin which is an exact copy of \p copy. No
     //! enumeration is triggered for either \p copy or of the newly constructed
     //! semigroup.
+    //!
+    //! If the elements are not stored by value, then the elements of \p copy
+    //! are not copied, but are shared read-only by \p copy and the newly
+    //! constructed semigroup (and any further copies of either), and they are
+    //! freed when the last of these is destroyed. Only the elements found
+    //! after the copy is made are stored separately by each copy. Elements
+    //! are not spilled by the copy.
+    //!
+    //! \throws LibsemigroupsException if \p copy spills elements, see
+    //! FroidurePin::spill.
     FroidurePin(FroidurePin const&);
 
     //! Default move constructor.
@@ -520,6 +686,137 @@ namespace libsemigroups {
     element_index_type fast_product(element_index_type,
                                     element_index_type) const override;
 
+    //! Finds the positions in \c this of the elements represented by many
+    //! words at once.
+    //!
+    //! After this member function returns, \c out[k] is equal to
+    //! \c word_to_pos(words[k]) for every \c k. The words are divided between
+    //! up to FroidurePin::max_threads threads if there are at least
+    //! FroidurePin::concurrency_threshold of them, and every thread traces
+    //! several words in the right Cayley graph at the same time, so that the
+    //! time spent waiting for memory is shared between the words.
+    //!
+    //! \param words the words.
+    //! \param out the vector for the positions, which is resized to
+    //! \c words.size().
+    //!
+    //! \returns
+    //! (None).
+    //!
+    //! \throws LibsemigroupsException if any word in \p words is empty, or
+    //! contains a letter which is not less than FroidurePin::nr_generators. In
+    //! this case \p out is not modified.
+    //!
+    //! \sa FroidurePin::word_to_pos.
+    void words_to_pos(std::vector<word_type> const&    words,
+                      std::vector<element_index_type>& out) const override;
+
+    //! Finds the positions in \c this of many products of elements at once
+    //! by following paths in the Cayley graphs.
+    //!
+    //! After this member function returns, \c out[k] is equal to
+    //! \c product_by_reduction(pairs[k].first, pairs[k].second) for every
+    //! \c k. The products are divided between threads, and traced several at
+    //! a time, as in FroidurePin::words_to_pos.
+    //!
+    //! \param pairs the positions of the elements to multiply.
+    //! \param out the vector for the positions of the products, which is
+    //! resized to \c pairs.size().
+    //!
+    //! \returns
+    //! (None).
+    //!
+    //! \throws LibsemigroupsException if any entry of \p pairs is not less
+    //! than FroidurePin::current_size. In this case \p out is not modified.
+    //!
+    //! \sa FroidurePin::product_by_reduction.
+    void products_by_reduction(
+        std::vector<std::pair<element_index_type, element_index_type>> const&
+                                         pairs,
+        std::vector<element_index_type>& out) const override;
+
+    //! Finds the positions in \c this of many products of elements at once.
+    //!
+    //! After this member function returns, \c out[k] is equal to
+    //! \c fast_product(pairs[k].first, pairs[k].second) for every \c k. The
+    //! products are divided between threads as in FroidurePin::words_to_pos,
+    //! and those that are found by following paths in the Cayley graphs are
+    //! traced several at a time.
+    //!
+    //! The thread id used for the products of elements in each thread is the
+    //! index of the thread, from \c 0 to FroidurePin::max_threads minus \c 1.
+    //! If the product of elements of type \c element_type uses temporary
+    //! storage for each thread id (such as the product of PBR objects), then
+    //! this member function should not be called from several threads at the
+    //! same time.
+    //!
+    //! \param pairs the positions of the elements to multiply.
+    //! \param out the vector for the positions of the products, which is
+    //! resized to \c pairs.size().
+    //!
+    //! \returns
+    //! (None).
+    //!
+    //! \throws LibsemigroupsException if any entry of \p pairs is not less
+    //! than FroidurePin::current_size. In this case \p out is not modified.
+    //!
+    //! \sa FroidurePin::fast_product.
+    void fast_products(
+        std::vector<std::pair<element_index_type, element_index_type>> const&
+                                         pairs,
+        std::vector<element_index_type>& out) const override;
+
+    //! Measure the relative cost of multiplying elements and of following
+    //! paths in the Cayley graphs.
+    //!
+    //! FroidurePin::fast_product, FroidurePin::fast_products, and the member
+    //! functions for idempotents, find a product either by following a path
+    //! in the right Cayley graph or by multiplying elements. By default, the
+    //! choice depends on the length of the path and an estimate of the cost
+    //! of a product given by the call operator of FroidurePin::Complexity.
+    //! This member function times products of elements of \c this, and steps
+    //! along paths in its right Cayley graph, and the choice is subsequently
+    //! made using the measured times instead.
+    //!
+    //! Since the measurement uses a sample of the elements of \c this, this
+    //! member function fully enumerates \c this. The measured times are not
+    //! copied by FroidurePin::copy_closure or FroidurePin::copy_add_generators
+    //! since they change the elements.
+    //!
+    //! \returns A reference to \c this.
+    //!
+    //! \exceptions
+    //! \no_libsemigroups_except
+    //!
+    //! \complexity
+    //! Linear in the size of \c this, plus the time taken to measure
+    //! approximately a millisecond of each type of operation.
+    //!
+    //! \par Parameters
+    //! None.
+    FroidurePin& calibrate();
+
+    //! Returns statistics about the enumeration of \c this so far.
+    //!
+    //! The statistics are only collected if libsemigroups is configured with
+    //! ``--enable-stats``, see FroidurePinStats for details. This member
+    //! function does not trigger any enumeration, and so can be called at
+    //! any time, for example after FroidurePin::run_for, or by a function
+    //! passed to FroidurePin::run_until. It must not be called by one thread
+    //! while another thread enumerates \c this.
+    //!
+    //! \returns A FroidurePinStats.
+    //!
+    //! \exceptions
+    //! \no_libsemigroups_except
+    //!
+    //! \complexity
+    //! Linear in FroidurePin::current_max_word_length.
+    //!
+    //! \par Parameters
+    //! None.
+    FroidurePinStats stats() const;
+
     //! Returns the position in \c this of the generator with index \p i.
     //!
     //! If \p i is not a valid generator index, a LibsemigroupsException will
@@ -667,6 +964,40 @@ namespace libsemigroups {
     //! None.
     cayley_graph_type const& left_cayley_graph() override;
 
+    //! Set whether or not the left Cayley graph is computed lazily.
+    //!
+    //! By default, the left Cayley graph of a FroidurePin is computed during
+    //! enumeration, which uses memory proportional to the size of the
+    //! semigroup times the number of generators. If this setting is \c true,
+    //! then the left Cayley graph is not stored during enumeration, and it
+    //! is only computed, from the right Cayley graph, the first time that it
+    //! is required (for example, by left or left_cayley_graph). Enumeration
+    //! is slightly slower in this case, since left multiples must be found
+    //! by tracing the right Cayley graph.
+    //!
+    //! Setting this to \c true discards the left Cayley graph if it was
+    //! already computed, and setting it to \c false computes the left Cayley
+    //! graph of the elements enumerated so far.
+    //!
+    //! \param val the value of the setting.
+    //!
+    //! \returns A reference to \c this.
+    //!
+    //! \exceptions
+    //! \no_libsemigroups_except
+    FroidurePin& lazy_left_cayley_graph(bool val);
+
+    //! Returns the current value of the setting for computing the left Cayley
+    //! graph lazily.
+    //!
+    //! \returns A value of type \c bool.
+    //!
+    //! \exceptions
+    //! \noexcept
+    //!
+    //! \sa FroidurePin::lazy_left_cayley_graph(bool).
+    bool lazy_left_cayley_graph() const noexcept;
+
     //! Changes \p word in-place to contain a minimal word with respect to the
     //! short-lex ordering in the generators equal to the \p pos element of
     //! the semigroup.
@@ -785,6 +1116,13 @@ namespace libsemigroups {
     //! its generating set).  All of the elements are stored in memory until the
     //! object is destroyed.
     //!
+    //! If FroidurePinBase::max_threads is greater than \c 1 and
+    //! FroidurePin::current_size is at least
+    //! FroidurePinBase::concurrency_threshold, then the products of the words
+    //! of each length with the generators are computed by multiple threads.
+    //! The positions of the elements are the same regardless of the number of
+    //! threads used.
+    //!
     //! The parameter \p limit defaults to FroidurePin::LIMIT_MAX.
     void enumerate(size_t) override;
 
@@ -815,6 +1153,13 @@ namespace libsemigroups {
     //! generators are the only new elements, unlike, say, in the case of
     //! non-trivial groups.
     //!
+    //! As in FroidurePin::enumerate, if FroidurePinBase::max_threads is greater
+    //! than \c 1 and FroidurePin::current_size is at least
+    //! FroidurePinBase::concurrency_threshold, then the products of the
+    //! previously enumerated elements with the generators are computed by
+    //! multiple threads, and the positions of the elements are the same
+    //! regardless of the number of threads used.
+    //!
     //! The elements of the argument \p coll are copied into the semigroup, and
     //! should be deleted by the caller.
     //! If an element in \p coll has a degree different to \c this->degree(), a
@@ -838,12 +1183,15 @@ namespace libsemigroups {
     //! FroidurePin::FroidurePin(const FroidurePin& copy) and then calling
     //! FroidurePin::add_generators on the copy, but this member function avoids
     //! copying the parts of \c this that are immediately invalidated by
-    //! FroidurePin::add_generators.
+    //! FroidurePin::add_generators. As for the copy constructor, the elements
+    //! of \c this are shared rather than copied, unless the degree of the
+    //! elements in \p coll is greater than FroidurePin::degree.
     //!
     //! The elements the argument \p coll are copied into the semigroup, and
     //! should be deleted by the caller.  If an element in \p coll has a degree
     //! different to \c this->degree(), a LibsemigroupsException will be
-    //! thrown.
+    //! thrown. A LibsemigroupsException is also thrown if \c this spills
+    //! elements, see FroidurePin::spill.
     template <typename TCollection>
     FroidurePin* copy_add_generators(TCollection const&) const;
 
@@ -884,12 +1232,14 @@ namespace libsemigroups {
     //! This member function is equivalent to copying \c this and then calling
     //! FroidurePin::closure on the copy with \p coll, but this member function
     //! avoids copying the parts of \c this that are immediately invalidated by
-    //! FroidurePin::closure.
+    //! FroidurePin::closure. As for FroidurePin::copy_add_generators, the
+    //! elements of \c this are shared rather than copied.
     //!
     //! The elements the argument \p coll are copied into the semigroup, and
     //! should be deleted by the caller.
     //! If an element in \p coll has a degree different to \c this->degree(), a
-    //! LibsemigroupsException will be thrown.
+    //! LibsemigroupsException will be thrown. A LibsemigroupsException is
+    //! also thrown if \c this spills elements, see FroidurePin::spill.
     template <typename TCollection>
     FroidurePin* copy_closure(TCollection const&);
 
@@ -910,6 +1260,158 @@ namespace libsemigroups {
 
     tril is_finite() override;
 
+    ////////////////////////////////////////////////////////////////////////
+    // FroidurePin - checkpointing - public
+    ////////////////////////////////////////////////////////////////////////
+
+    //! Write the current state of the enumeration to a file.
+    //!
+    //! This member function writes the Cayley graphs, the normal forms, and
+    //! the rest of the data required to continue the enumeration of \c this
+    //! from where it is now, to the file \p path. The elements themselves are
+    //! not written, they are recomputed from their normal forms by
+    //! FroidurePin::load. The file is first written to \p path with the
+    //! suffix \c ".tmp" and then renamed, so that \p path is never left
+    //! partially written.
+    //!
+    //! \param path the name of the file to write.
+    //!
+    //! \returns
+    //! (None).
+    //!
+    //! \throws LibsemigroupsException if the file cannot be written.
+    //!
+    //! \complexity
+    //! Linear in FroidurePin::current_size and
+    //! FroidurePin::nr_generators.
+    //!
+    //! \sa FroidurePin::load and FroidurePin::checkpoint.
+    void save(std::string const& path) const;
+
+    //! Restore the state of the enumeration from a file.
+    //!
+    //! This member function replaces the enumerated part of \c this by the
+    //! data in the file \p path, which must have been written by
+    //! FroidurePin::save for a FroidurePin with the same generators in the
+    //! same order. After calling this member function, the enumeration of
+    //! \c this continues from exactly where it was when the file was written.
+    //!
+    //! \param path the name of the file to read.
+    //!
+    //! \returns
+    //! (None).
+    //!
+    //! \throws LibsemigroupsException if the file cannot be read, was not
+    //! written by FroidurePin::save, or was written for a FroidurePin with
+    //! different generators.
+    //!
+    //! \complexity
+    //! At most FroidurePin::current_size products of elements of \c this,
+    //! where the size is that stored in the file.
+    //!
+    //! \sa FroidurePin::save.
+    void load(std::string const& path);
+
+    //! Set the file used for automatic checkpoints.
+    //!
+    //! If \p path is not empty, then FroidurePin::save is called with
+    //! argument \p path every time that the enumeration finishes all of the
+    //! words of a given length. If the enumeration is interrupted, then at
+    //! most the words of one length must be enumerated again after calling
+    //! FroidurePin::load. If \p path is empty, then no automatic checkpoints
+    //! are written, this is the default.
+    //!
+    //! \param path the name of the checkpoint file.
+    //!
+    //! \returns A reference to \c this.
+    //!
+    //! \exceptions
+    //! \no_libsemigroups_except
+    //!
+    //! \sa FroidurePin::save.
+    FroidurePin& checkpoint(std::string const& path);
+
+    //! Returns the name of the file used for automatic checkpoints.
+    //!
+    //! \returns A const reference to a \c std::string, which is empty if
+    //! automatic checkpoints are disabled.
+    //!
+    //! \exceptions
+    //! \noexcept
+    //!
+    //! \sa checkpoint(std::string const&).
+    std::string const& checkpoint() const noexcept;
+
+    ////////////////////////////////////////////////////////////////////////
+    // FroidurePin - spilling - public
+    ////////////////////////////////////////////////////////////////////////
+
+    //! Move the elements of completed word lengths out of memory.
+    //!
+    //! If \p path is not empty, then every time that the enumeration
+    //! finishes all of the words of a given length, the elements that will
+    //! not be multiplied by the generators again are written to the file \p
+    //! path (which is created or truncated), and the memory they occupy is
+    //! freed. These elements are then read from a read-only memory mapping of
+    //! the file, and so FroidurePin::at, FroidurePin::position, iterators,
+    //! and so on, continue to work as before. The pages of the mapping are
+    //! backed by the file, and so the operating system can evict them when
+    //! memory is short, and read them back when they are used again. If \p
+    //! path is empty, then any elements already written to a file are
+    //! copied back into memory, and the file is removed. The file is also
+    //! removed when \c this is destroyed.
+    //!
+    //! The memory used by each spilled element is then one pointer in the
+    //! list of elements, and one slot (a 64-bit hash value and an
+    //! element_index_type) in the hash index used to recognise elements that
+    //! have already been found, the latter at a load factor of at most 3/4.
+    //! Neither of these depend on FroidurePin::element_type. The Cayley graphs
+    //! and the data defining the normal forms are unchanged. The elements that
+    //! are generators are never spilled.
+    //!
+    //! Since spilled elements are compared against every new product with
+    //! the same hash value, spilling is most effective when the hash function
+    //! has few collisions, and when there are few lookups of spilled elements
+    //! that are not resident in memory.
+    //!
+    //! \param path the name of the spill file.
+    //!
+    //! \returns A reference to \c this.
+    //!
+    //! \throws LibsemigroupsException if FroidurePin::element_type is not
+    //! trivially copyable, is a pointer, or is stored by value (i.e. it is
+    //! small and trivial); if the elements of \c this are shared with a copy of \c
+    //! this; or if the file cannot be created.
+    //!
+    //! \sa FroidurePin::nr_spilled.
+    FroidurePin& spill(std::string const& path);
+
+    //! Returns the name of the file used for spilling elements.
+    //!
+    //! \returns A const reference to a \c std::string, which is empty if
+    //! elements are not being spilled.
+    //!
+    //! \exceptions
+    //! \noexcept
+    //!
+    //! \sa spill(std::string const&).
+    std::string const& spill() const noexcept;
+
+    //! Returns the number of elements that have been spilled.
+    //!
+    //! Every element whose index is less than the returned value, and which
+    //! is not a generator, is read from the spill file rather than memory.
+    //!
+    //! \returns A value of type \c size_type.
+    //!
+    //! \exceptions
+    //! \noexcept
+    //!
+    //! \sa spill(std::string const&).
+    size_type nr_spilled() const noexcept {
+      return _nr_spilled;
+    }
+
    private:
     ////////////////////////////////////////////////////////////////////////
     // FroidurePin - validation member functions - private
@@ -927,8 +1429,36 @@ namespace libsemigroups {
     is_one(internal_const_element_type x, element_index_type) noexcept(
         std::is_nothrow_default_constructible<InternalEqualTo>::
             value&& noexcept(std::declval<InternalEqualTo>()(x, x)));
+    inline element_index_type map_find(internal_const_element_type) const;
+    inline void               map_insert(element_index_type);
+    inline element_index_type left_product(element_index_type,
+                                           letter_type) const;
+
+    using shared_elements_type
+        = detail::FroidurePinSharedElements<TElementType, Storage>;
 
     void copy_gens();
+    void share_elements() const;
+    void free_elements();
+    void write_checkpoint(std::string const&) const;
+    // Elements can only be spilled if they are stored by pointer, and can be
+    // copied byte by byte.
+    using is_spillable = std::integral_constant<
+        bool,
+        std::is_same<internal_element_type, element_type*>::value
+            && std::is_trivially_copyable<element_type>::value>;
+
+    // Record statistics about the products of the words currently being
+    // multiplied by the generators, see stats. These member functions do
+    // nothing unless LIBSEMIGROUPS_STATS is defined.
+    inline void stats_product(bool is_new);
+    inline void stats_product_avoided();
+    inline void stats_time(detail::Timer&);
+
+    void spill_elements(std::true_type);
+    void spill_elements(std::false_type) {}
+    void unspill_elements();
+    void repoint_sorted_and_idempotents();
     void closure_update(element_index_type,
                         letter_type,
                         letter_type,
@@ -936,6 +1466,46 @@ namespace libsemigroups {
                         size_type,
                         size_t const&,
                         std::vector<bool>&);
+    void closure_update_old(element_index_type,
+                            element_index_type,
+                            letter_type,
+                            std::vector<bool>&);
+    void closure_update_concurrently(enumerate_index_type,
+                                     letter_type,
+                                     size_type,
+                                     size_type&,
+                                     std::vector<bool>&);
+    // The number of words or products traced at the same time by
+    // trace_words and trace_products.
+    static constexpr size_t trace_batch_size = 8;
+
+    // The number of pairs of elements used by calibrate.
+    static constexpr size_t calibration_sample_size = 256;
+
+    inline size_t fast_product_threshold() const;
+    inline size_t idempotent_threshold() const;
+
+    void multiply_words_concurrently(enumerate_index_type);
+    void trace_words(std::vector<word_type> const&,
+                     std::vector<element_index_type>&,
+                     size_t const,
+                     size_t const) const;
+    void trace_products(
+        std::vector<std::pair<element_index_type, element_index_type>> const&,
+        std::vector<element_index_type>&,
+        size_t const*,
+        size_t const) const;
+    template <typename TFunction>
+    void for_each_block(size_t const, TFunction&&) const;
+    void products_concurrently(enumerate_index_type const,
+                               letter_type const,
+                               std::vector<element_index_type>&,
+                               std::vector<internal_element_type>&) const;
+    void products_by_generators(enumerate_index_type const,
+                                enumerate_index_type const,
+                                letter_type const,
+                                std::vector<element_index_type>&,
+                                std::vector<internal_element_type>&) const;
 
     ////////////////////////////////////////////////////////////////////////
     // FroidurePin - initialisation member functions - private
@@ -944,12 +1514,14 @@ namespace libsemigroups {
     using internal_idempotent_pair
         = std::pair<internal_element_type, element_index_type>;
 
+    void init_left();
+    void init_left_layer(enumerate_index_type const,
+                         enumerate_index_type const);
     void init_sorted();
     void init_idempotents();
-    void idempotents(enumerate_index_type const,
-                     enumerate_index_type const,
+    void idempotents(std::atomic<size_t>&,
                      enumerate_index_type const,
-                     std::vector<internal_idempotent_pair>&);
+                     std::vector<uint8_t>&);
 
     ////////////////////////////////////////////////////////////////////////
     // FroidurePin - iterators - private
@@ -1119,51 +1691,56 @@ namespace libsemigroups {
     // FroidurePin - data - private
     ////////////////////////////////////////////////////////////////////////
 
+    std::string                                      _checkpoint;
     size_t                                           _degree;
     std::vector<std::pair<letter_type, letter_type>> _duplicate_gens;
     std::vector<internal_element_type>               _elements;
     std::vector<element_index_type>                  _enumerate_order;
+    size_t                                           _fast_product_threshold;
     std::vector<letter_type>                         _final;
     std::vector<letter_type>                         _first;
     bool                                             _found_one;
     std::vector<internal_element_type>               _gens;
     internal_element_type                            _id;
+    size_t                                           _idempotent_threshold;
     std::vector<internal_idempotent_pair>            _idempotents;
     bool                                             _idempotents_found;
     std::vector<bool>                                _is_idempotent;
     cayley_graph_type                                _left;
+    bool                                             _left_lazy;
     std::vector<size_type>                           _length;
     std::vector<enumerate_index_type>                _lenindex;
     std::vector<element_index_type>                  _letter_to_pos;
-    // #ifdef LIBSEMIGROUPS_DENSEHASHMAP
-    //     google::dense_hash_map<internal_const_element_type,
-    //                            element_index_type,
-    //                            InternalHash,
-    //                            InternalEqualTo>
-    //         _map;
-    // #else
-    std::unordered_map<internal_const_element_type,
-                       element_index_type,
-                       InternalHash,
-                       InternalEqualTo>
-        _map;
-    // #endif
+    detail::FlatHashIndex<element_index_type>        _map;
     mutable std::mutex              _mtx;
     size_type                       _nr;
     letter_type                     _nrgens;
     size_t                          _nr_rules;
+    mutable size_type               _nr_shared;
+    size_type                       _nr_spilled;
     enumerate_index_type            _pos;
     element_index_type              _pos_one;
     std::vector<element_index_type> _prefix;
-    detail::DynamicArray2<bool>     _reduced;
+    detail::BitArray2               _reduced;
     letter_type                     _relation_gen;
     enumerate_index_type            _relation_pos;
     cayley_graph_type               _right;
+    mutable std::shared_ptr<shared_elements_type const>               _shared;
     std::vector<std::pair<internal_element_type, element_index_type>> _sorted;
+    std::unique_ptr<detail::SpillFile>                                _spill;
+    mutable Storage                                                   _storage;
     std::vector<element_index_type>                                   _suffix;
     mutable internal_element_type _tmp_product;
     size_t                        _wordlen;
 
+#ifdef LIBSEMIGROUPS_STATS
+    std::vector<FroidurePinStats::Layer> _stats_layers;
+    mutable detail::StatsCounter         _stats_hash_comparisons;
+    mutable detail::StatsCounter         _stats_hash_lookups;
+    mutable detail::StatsCounter         _stats_hash_probes;
+    mutable detail::StatsCounter         _stats_max_hash_probes;
+#endif
+
 #ifdef LIBSEMIGROUPS_VERBOSE
     size_t _nr_products;
 #endif
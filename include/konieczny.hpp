@@ -0,0 +1,736 @@
+//
+// libsemigroups - C++ library for semigroups and monoids
+// Copyright (C) 2019 James D. Mitchell
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+// This file contains an implementation of a class Konieczny for computing the
+// Green's structure of a semigroup of transformations or partial perms
+// without enumerating its elements. Every R-class is represented by a single
+// element together with the strongly connected component of the action of the
+// semigroup on images containing the image of the representative, and the
+// Schutzenberger group of that component as a SchreierSims instance, as
+// described in:
+//
+// J. East, A. Egri-Nagy, J. D. Mitchell, and Y. Peresse, Computing finite
+// semigroups, J. Symbolic Comput., 92 (2019) 110--155.
+//
+// and in the papers of Lallement and McFadden, and of Konieczny, cited there.
+
+#ifndef LIBSEMIGROUPS_INCLUDE_KONIECZNY_HPP_
+#define LIBSEMIGROUPS_INCLUDE_KONIECZNY_HPP_
+
+#include <algorithm>      // for sort, unique, binary_search
+#include <cstddef>        // for size_t
+#include <cstdint>        // for uint64_t
+#include <memory>         // for unique_ptr
+#include <unordered_map>  // for unordered_map
+#include <vector>         // for vector
+
+#include "action.hpp"                   // for RightAction, LeftAction
+#include "adapters.hpp"                 // for One, Product
+#include "constants.hpp"                // for UNDEFINED
+#include "digraph.hpp"                  // for ActionDigraph
+#include "element.hpp"                  // for Transformation, PartialPerm
+#include "libsemigroups-debug.hpp"      // for LIBSEMIGROUPS_ASSERT
+#include "libsemigroups-exception.hpp"  // for LIBSEMIGROUPS_EXCEPTION
+#include "report.hpp"                   // for REPORT_DEFAULT
+#include "runner.hpp"                   // for Runner
+#include "schreier-sims.hpp"            // for SchreierSims
+#include "stl.hpp"                      // for hash<std::vector>
+
+namespace libsemigroups {
+
+  //! Defined in ``konieczny.hpp``.
+  //!
+  //! This is a traits class for use with Konieczny. A specialisation must
+  //! define the types `lambda_value_type` and `rho_value_type` of the values
+  //! of the functions \f$\lambda\f$ and \f$\rho\f$ (for example, the image
+  //! and the kernel of a transformation), and stateless structs `Lambda`,
+  //! `Rho`, `LambdaAction`, `RhoAction` and `ContainsIdempotent`.
+  //!
+  //! `Lambda` and `Rho` compute \f$\lambda(x)\f$ and \f$\rho(x)\f$;
+  //! `LambdaAction` is the right action of elements on the values of
+  //! \f$\lambda\f$, and `RhoAction` is the left action on the values of
+  //! \f$\rho\f$, both with the signature required by Action.
+  //! `ContainsIdempotent` returns \c true if the H-class of elements with the
+  //! given values of \f$\lambda\f$ and \f$\rho\f$ contains an idempotent.
+  //!
+  //! \tparam TElementType the type of the elements.
+  template <typename TElementType>
+  struct KoniecznyTraits;
+
+  //! Specialization of KoniecznyTraits for Transformation instances. The
+  //! value of \f$\lambda\f$ is the image, stored as a sorted vector, and the
+  //! value of \f$\rho\f$ is the kernel, stored as the vector whose \c i-th
+  //! entry is the index of the kernel class of \c i, where kernel classes are
+  //! numbered in the order they are first encountered.
+  template <typename TIntType>
+  struct KoniecznyTraits<Transformation<TIntType>> {
+    using element_type      = Transformation<TIntType>;
+    using lambda_value_type = std::vector<TIntType>;
+    using rho_value_type    = std::vector<TIntType>;
+
+    struct Lambda {
+      void operator()(lambda_value_type& res, element_type const& x) const {
+        res.assign(x.cbegin(), x.cend());
+        std::sort(res.begin(), res.end());
+        res.erase(std::unique(res.begin(), res.end()), res.end());
+      }
+    };
+
+    struct LambdaAction {
+      void operator()(lambda_value_type&       res,
+                      lambda_value_type const& pt,
+                      element_type const&      x) const {
+        res.clear();
+        for (auto const& i : pt) {
+          res.push_back(x[i]);
+        }
+        std::sort(res.begin(), res.end());
+        res.erase(std::unique(res.begin(), res.end()), res.end());
+      }
+    };
+
+    struct Rho {
+      void operator()(rho_value_type& res, element_type const& x) const {
+        size_t const          n = x.degree();
+        std::vector<TIntType> lookup(n, static_cast<TIntType>(UNDEFINED));
+        TIntType              next = 0;
+        res.resize(n);
+        for (size_t i = 0; i < n; ++i) {
+          if (lookup[x[i]] == static_cast<TIntType>(UNDEFINED)) {
+            lookup[x[i]] = next++;
+          }
+          res[i] = lookup[x[i]];
+        }
+      }
+    };
+
+    struct RhoAction {
+      void operator()(rho_value_type&       res,
+                      rho_value_type const& pt,
+                      element_type const&   x) const {
+        size_t const          n = x.degree();
+        std::vector<TIntType> lookup(n, static_cast<TIntType>(UNDEFINED));
+        TIntType              next = 0;
+        res.resize(n);
+        for (size_t i = 0; i < n; ++i) {
+          TIntType const j = pt[x[i]];
+          if (lookup[j] == static_cast<TIntType>(UNDEFINED)) {
+            lookup[j] = next++;
+          }
+          res[i] = lookup[j];
+        }
+      }
+    };
+
+    // An H-class contains an idempotent if and only if its image is a
+    // transversal of its kernel.
+    struct ContainsIdempotent {
+      bool operator()(lambda_value_type const& img,
+                      rho_value_type const&    ker) const {
+        size_t const nr_classes
+            = (ker.empty() ? 0 : *std::max_element(ker.cbegin(), ker.cend()))
+              + 1;
+        if (img.size() != nr_classes) {
+          return false;
+        }
+        std::vector<bool> seen(nr_classes, false);
+        for (auto const& i : img) {
+          if (seen[ker[i]]) {
+            return false;
+          }
+          seen[ker[i]] = true;
+        }
+        return true;
+      }
+    };
+  };
+
+  //! Specialization of KoniecznyTraits for PartialPerm instances. The values
+  //! of \f$\lambda\f$ and \f$\rho\f$ are the image and the domain,
+  //! respectively, stored as sorted vectors.
+  template <typename TIntType>
+  struct KoniecznyTraits<PartialPerm<TIntType>> {
+    using element_type      = PartialPerm<TIntType>;
+    using lambda_value_type = std::vector<TIntType>;
+    using rho_value_type    = std::vector<TIntType>;
+
+    struct Lambda {
+      void operator()(lambda_value_type& res, element_type const& x) const {
+        res.clear();
+        for (auto it = x.cbegin(); it < x.cend(); ++it) {
+          if (*it != UNDEFINED) {
+            res.push_back(*it);
+          }
+        }
+        std::sort(res.begin(), res.end());
+      }
+    };
+
+    struct LambdaAction {
+      void operator()(lambda_value_type&       res,
+                      lambda_value_type const& pt,
+                      element_type const&      x) const {
+        res.clear();
+        for (auto const& i : pt) {
+          if (x[i] != UNDEFINED) {
+            res.push_back(x[i]);
+          }
+        }
+        std::sort(res.begin(), res.end());
+      }
+    };
+
+    struct Rho {
+      void operator()(rho_value_type& res, element_type const& x) const {
+        res.clear();
+        size_t const n = x.degree();
+        for (size_t i = 0; i < n; ++i) {
+          if (x[i] != UNDEFINED) {
+            res.push_back(i);
+          }
+        }
+      }
+    };
+
+    struct RhoAction {
+      void operator()(rho_value_type&       res,
+                      rho_value_type const& pt,
+                      element_type const&   x) const {
+        res.clear();
+        size_t const n = x.degree();
+        for (size_t i = 0; i < n; ++i) {
+          if (x[i] != UNDEFINED
+              && std::binary_search(pt.cbegin(), pt.cend(), x[i])) {
+            res.push_back(i);
+          }
+        }
+      }
+    };
+
+    struct ContainsIdempotent {
+      bool operator()(lambda_value_type const& img,
+                      rho_value_type const&    dom) const {
+        return img == dom;
+      }
+    };
+  };
+
+  //! Defined in ``konieczny.hpp``.
+  //!
+  //! This class implements an algorithm for computing the size, the number of
+  //! idempotents, the numbers of D-, R-, L-, and H-classes of, and for testing
+  //! membership in, a semigroup of transformations or partial perms, without
+  //! enumerating its elements.
+  //!
+  //! The ``run`` member function computes the action of the semigroup on the
+  //! values of \f$\lambda\f$ (images) and \f$\rho\f$ (kernels or domains),
+  //! and then finds one representative of every R-class by left multiplying
+  //! the representatives already found by the generators. An R-class is
+  //! stored as its representative, whose image is the root of its strongly
+  //! connected component in the image action, and the Schutzenberger group of
+  //! that component, which is computed once per component using SchreierSims.
+  //! The D-classes are the strongly connected components of the digraph of the
+  //! left action of the generators on the R-classes.
+  //!
+  //! The memory used is proportional to the sizes of the actions on images
+  //! and kernels plus the number of R-classes, rather than to the size of the
+  //! semigroup.
+  //!
+  //! \tparam N the maximum degree of the elements, this is the degree of the
+  //! permutations used to represent the Schutzenberger groups.
+  //!
+  //! \tparam TElementType the type of the elements, currently
+  //! Transformation or PartialPerm.
+  //!
+  //! \tparam TTraits the type of a traits class with the requirements of
+  //! KoniecznyTraits.
+  //!
+  //! \par Example
+  //! \code
+  //! using Transf = Transformation<uint8_t>;
+  //! Konieczny<5, Transf> K({Transf({1, 0, 2, 3, 4}),
+  //!                         Transf({1, 2, 3, 4, 0}),
+  //!                         Transf({0, 0, 2, 3, 4})});
+  //! K.size();            // 3125
+  //! K.nr_D_classes();    // 5
+  //! K.nr_idempotents();  // 196
+  //! \endcode
+  template <size_t N,
+            typename TElementType,
+            typename TTraits = KoniecznyTraits<TElementType>>
+  class Konieczny final : public Runner {
+    using lambda_value_type  = typename TTraits::lambda_value_type;
+    using rho_value_type     = typename TTraits::rho_value_type;
+    using Lambda             = typename TTraits::Lambda;
+    using Rho                = typename TTraits::Rho;
+    using LambdaAction       = typename TTraits::LambdaAction;
+    using RhoAction          = typename TTraits::RhoAction;
+    using ContainsIdempotent = typename TTraits::ContainsIdempotent;
+
+    using group_type = SchreierSims<N>;
+    using perm_type  = typename group_type::element_type;
+    using point_type = typename group_type::point_type;
+
+   public:
+    ////////////////////////////////////////////////////////////////////////
+    // Konieczny - typedefs - public
+    ////////////////////////////////////////////////////////////////////////
+
+    //! The type of the elements.
+    using element_type = TElementType;
+
+    //! The type of the action of the semigroup on images.
+    using lambda_orb_type
+        = RightAction<element_type, lambda_value_type, LambdaAction>;
+
+    //! The type of the action of the semigroup on kernels.
+    using rho_orb_type = LeftAction<element_type, rho_value_type, RhoAction>;
+
+    ////////////////////////////////////////////////////////////////////////
+    // Konieczny - constructors + destructor - public
+    ////////////////////////////////////////////////////////////////////////
+
+    //! Default constructor.
+    //!
+    //! Constructs a Konieczny instance with no generators.
+    Konieczny()
+        : _degree(UNDEFINED),
+          _gens(),
+          _graph(),
+          _groups(),
+          _init(false),
+          _lambda_orb(),
+          _lambda_to_root(),
+          _lambda_to_root_defined(),
+          _pos(0),
+          _reps(),
+          _reps_lambda_scc(),
+          _reps_lookup(),
+          _reps_rho_pos(),
+          _rho_orb(),
+          _tmp_element1(),
+          _tmp_element2(),
+          _tmp_lambda(),
+          _tmp_rho() {}
+
+    //! Constructs a Konieczny instance generated by \p gens.
+    //!
+    //! \param gens the generators.
+    //!
+    //! \throws LibsemigroupsException if the generators do not all have the
+    //! same degree, or if their degree exceeds the template parameter \p N.
+    explicit Konieczny(std::vector<element_type> const& gens) : Konieczny() {
+      for (auto const& x : gens) {
+        add_generator(x);
+      }
+    }
+
+    //! Deleted.
+    Konieczny(Konieczny const&) = delete;
+
+    //! Deleted.
+    Konieczny(Konieczny&&) = delete;
+
+    //! Deleted.
+    Konieczny& operator=(Konieczny const&) = delete;
+
+    //! Deleted.
+    Konieczny& operator=(Konieczny&&) = delete;
+
+    ~Konieczny() = default;
+
+    ////////////////////////////////////////////////////////////////////////
+    // Konieczny - generators - public
+    ////////////////////////////////////////////////////////////////////////
+
+    //! Add a generator.
+    //!
+    //! \param x the generator to add.
+    //!
+    //! \returns
+    //! (None)
+    //!
+    //! \throws LibsemigroupsException if \p x does not have the same degree
+    //! as any existing generator, if the degree of \p x exceeds the template
+    //! parameter \p N, or if the enumeration has already begun.
+    void add_generator(element_type const& x) {
+      if (_init) {
+        LIBSEMIGROUPS_EXCEPTION(
+            "cannot add generators after the enumeration has begun");
+      }
+      size_t const n = x.degree();
+      if (n > N) {
+        LIBSEMIGROUPS_EXCEPTION(
+            "generator degree too large, expected at most %d, got %d", N, n);
+      } else if (!_gens.empty() && n != _degree) {
+        LIBSEMIGROUPS_EXCEPTION(
+            "generator degree incorrect, expected %d, got %d", _degree, n);
+      }
+      _degree = n;
+      _gens.push_back(x);
+    }
+
+    //! Returns the number of generators.
+    size_t nr_generators() const noexcept {
+      return _gens.size();
+    }
+
+    //! Returns a const reference to the generator with index \p i.
+    //!
+    //! \throws std::out_of_range if \p i is out of bounds.
+    element_type const& generator(size_t i) const {
+      return _gens.at(i);
+    }
+
+    //! Returns the degree of the generators, or libsemigroups::UNDEFINED if
+    //! there are no generators.
+    size_t degree() const noexcept {
+      return _degree;
+    }
+
+    ////////////////////////////////////////////////////////////////////////
+    // Konieczny - attributes - public
+    ////////////////////////////////////////////////////////////////////////
+
+    //! Returns the size of the semigroup.
+    //!
+    //! This is the sum over the R-classes of the size of the strongly
+    //! connected component of its image times the size of its Schutzenberger
+    //! group.
+    //!
+    //! \returns A value of type \c uint64_t.
+    //!
+    //! \par Parameters
+    //! (None)
+    uint64_t size() {
+      run();
+      uint64_t out = 0;
+      for (size_t i = 0; i < _reps.size(); ++i) {
+        out += lambda_scc_size(_reps_lambda_scc[i])
+               * _groups[_reps_lambda_scc[i]]->size();
+      }
+      return out;
+    }
+
+    //! Returns the number of idempotents in the semigroup.
+    //!
+    //! Every H-class contains at most one idempotent, and this is determined
+    //! by the values of \f$\lambda\f$ and \f$\rho\f$ of the H-class alone, so
+    //! the idempotents are counted without being constructed.
+    //!
+    //! \returns A value of type \c uint64_t.
+    //!
+    //! \par Parameters
+    //! (None)
+    uint64_t nr_idempotents() {
+      run();
+      auto const& gr  = _lambda_orb.digraph();
+      uint64_t    out = 0;
+      for (size_t i = 0; i < _reps.size(); ++i) {
+        rho_value_type const& ker = _rho_orb[_reps_rho_pos[i]];
+        for (auto it = gr.cbegin_scc(_reps_lambda_scc[i]);
+             it < gr.cend_scc(_reps_lambda_scc[i]);
+             ++it) {
+          if (ContainsIdempotent()(_lambda_orb[*it], ker)) {
+            ++out;
+          }
+        }
+      }
+      return out;
+    }
+
+    //! Returns the number of D-classes of the semigroup.
+    size_t nr_D_classes() {
+      run();
+      return _graph.nr_scc();
+    }
+
+    //! Returns the number of R-classes of the semigroup.
+    size_t nr_R_classes() {
+      run();
+      return _reps.size();
+    }
+
+    //! Returns the number of L-classes of the semigroup.
+    //!
+    //! The number of L-classes in a D-class equals the size of the strongly
+    //! connected component of the image of any of its elements.
+    size_t nr_L_classes() {
+      run();
+      size_t out = 0;
+      for (auto it = _graph.cbegin_scc_roots(); it < _graph.cend_scc_roots();
+           ++it) {
+        out += lambda_scc_size(_reps_lambda_scc[*it]);
+      }
+      return out;
+    }
+
+    //! Returns the number of H-classes of the semigroup.
+    size_t nr_H_classes() {
+      run();
+      size_t out = 0;
+      for (size_t i = 0; i < _reps.size(); ++i) {
+        out += lambda_scc_size(_reps_lambda_scc[i]);
+      }
+      return out;
+    }
+
+    //! Returns the number of R-classes found so far.
+    size_t current_nr_R_classes() const noexcept {
+      return _reps.size();
+    }
+
+    //! Returns a const reference to the representative of the R-class with
+    //! index \p i.
+    //!
+    //! \throws std::out_of_range if \p i is out of bounds.
+    element_type const& R_class_rep(size_t i) const {
+      return _reps.at(i);
+    }
+
+    //! Returns the index of the D-class containing the R-class with index \p
+    //! i.
+    size_t D_class_of_R_class(size_t i) {
+      run();
+      return _graph.scc_id(i);
+    }
+
+    //! Returns a const reference to the action on images.
+    lambda_orb_type const& lambda_orb() {
+      init();
+      return _lambda_orb;
+    }
+
+    //! Returns a const reference to the action on kernels.
+    rho_orb_type const& rho_orb() {
+      init();
+      return _rho_orb;
+    }
+
+    //! Test membership of an element.
+    //!
+    //! \param x a const reference to a possible element.
+    //!
+    //! \returns \c true if \p x belongs to the semigroup and \c false if not.
+    //!
+    //! \complexity
+    //! After the enumeration, at most linear in the number of R-classes with
+    //! the same kernel as \p x, times the complexity of sifting through a
+    //! SchreierSims stabiliser chain.
+    bool contains(element_type const& x) {
+      if (_gens.empty() || x.degree() != _degree) {
+        return false;
+      }
+      run();
+      return find_R_class(x) != UNDEFINED;
+    }
+
+   private:
+    ////////////////////////////////////////////////////////////////////////
+    // Runner - pure virtual member functions - private
+    ////////////////////////////////////////////////////////////////////////
+
+    bool finished_impl() const override {
+      return _gens.empty() || (_init && _pos == _reps.size());
+    }
+
+    void run_impl() override {
+      init();
+      for (; _pos < _reps.size() && !stopped(); ++_pos) {
+        for (size_t j = 0; j < _gens.size(); ++j) {
+          Product()(_tmp_element1, _gens[j], _reps[_pos]);
+          _graph.add_edge(_pos, find_or_add_R_class(_tmp_element1), j);
+        }
+        if (report()) {
+          REPORT_DEFAULT("found %d R-classes, so far\n", _reps.size());
+        }
+      }
+      report_why_we_stopped();
+    }
+
+    ////////////////////////////////////////////////////////////////////////
+    // Konieczny - member functions - private
+    ////////////////////////////////////////////////////////////////////////
+
+    using One     = ::libsemigroups::One<element_type>;
+    using Product = ::libsemigroups::Product<element_type>;
+
+    void init() {
+      if (_init || _gens.empty()) {
+        return;
+      }
+      element_type const id = One()(_degree);
+      _tmp_element1         = id;
+      _tmp_element2         = id;
+      Lambda()(_tmp_lambda, id);
+      _lambda_orb.add_seed(_tmp_lambda);
+      Rho()(_tmp_rho, id);
+      _rho_orb.add_seed(_tmp_rho);
+      for (auto const& x : _gens) {
+        _lambda_orb.add_generator(x);
+        _rho_orb.add_generator(x);
+      }
+      _lambda_orb.run();
+      _rho_orb.run();
+      REPORT_DEFAULT("found %d images and %d kernels\n",
+                     _lambda_orb.current_size(),
+                     _rho_orb.current_size());
+
+      _groups.resize(_lambda_orb.digraph().nr_scc());
+      _lambda_to_root.resize(_lambda_orb.current_size(), id);
+      _lambda_to_root_defined.resize(_lambda_orb.current_size(), false);
+      _graph.add_to_out_degree(_gens.size());
+      _init = true;
+
+      for (auto const& x : _gens) {
+        find_or_add_R_class(x);
+      }
+    }
+
+    size_t lambda_scc_size(size_t scc) {
+      auto const& gr = _lambda_orb.digraph();
+      return gr.cend_scc(scc) - gr.cbegin_scc(scc);
+    }
+
+    element_type const& lambda_to_root(size_t pos) {
+      if (!_lambda_to_root_defined[pos]) {
+        _lambda_to_root[pos]         = _lambda_orb.multiplier_to_scc_root(pos);
+        _lambda_to_root_defined[pos] = true;
+      }
+      return _lambda_to_root[pos];
+    }
+
+    // Returns the Schutzenberger group of the strongly connected component
+    // with index <scc> in the action on images, this is generated by the
+    // restrictions to the root of the elements u_p s v_q where p is in the
+    // component, s is a generator, q = p s is in the component, and u_p and
+    // v_q are the multipliers from and to the root.
+    group_type& group(size_t scc) {
+      if (_groups[scc] == nullptr) {
+        _groups[scc] = std::unique_ptr<group_type>(new group_type());
+        auto const&              gr   = _lambda_orb.digraph();
+        lambda_value_type const& root = _lambda_orb[*gr.cbegin_scc(scc)];
+        for (auto it = gr.cbegin_scc(scc); it < gr.cend_scc(scc); ++it) {
+          element_type const u = _lambda_orb.multiplier_from_scc_root(*it);
+          for (size_t j = 0; j < _gens.size(); ++j) {
+            size_t const q = gr.neighbor(*it, j);
+            if (gr.scc_id(q) == scc) {
+              Product()(_tmp_element2, u, _gens[j]);
+              Product()(_tmp_element1, _tmp_element2, lambda_to_root(q));
+              perm_type p(_groups[scc]->identity());
+              for (auto const& i : root) {
+                p[i] = static_cast<point_type>(_tmp_element1[i]);
+              }
+              _groups[scc]->add_generator(p);
+            }
+          }
+        }
+      }
+      return *_groups[scc];
+    }
+
+    // Returns the index of the R-class containing <x>, or UNDEFINED if there
+    // is no such R-class. When <x> has a known image and kernel, then
+    // _tmp_element2 holds the element of the R-class of <x> whose image is the
+    // root of its component.
+    size_t find_R_class(element_type const& x) {
+      Lambda()(_tmp_lambda, x);
+      size_t const lpos = _lambda_orb.position(_tmp_lambda);
+      if (lpos == UNDEFINED) {
+        return UNDEFINED;
+      }
+      Rho()(_tmp_rho, x);
+      size_t const rpos = _rho_orb.position(_tmp_rho);
+      if (rpos == UNDEFINED) {
+        return UNDEFINED;
+      }
+      Product()(_tmp_element2, x, lambda_to_root(lpos));
+      size_t const scc = _lambda_orb.digraph().scc_id(lpos);
+      auto         it  = _reps_lookup.find(key(scc, rpos));
+      if (it == _reps_lookup.end()) {
+        return UNDEFINED;
+      }
+      // The group was computed when the first R-class in the bucket was added.
+      LIBSEMIGROUPS_ASSERT(_groups[scc] != nullptr);
+      group_type& grp = *_groups[scc];
+      for (size_t const r : it->second) {
+        // The representative <rep> and _tmp_element2 have equal kernels and
+        // images, and so they differ by a permutation of their image.
+        element_type const& rep = _reps[r];
+        perm_type           p(grp.identity());
+        for (size_t i = 0; i < _degree; ++i) {
+          if (rep[i] != UNDEFINED) {
+            p[rep[i]] = static_cast<point_type>(_tmp_element2[i]);
+          }
+        }
+        if (grp.contains(p)) {
+          return r;
+        }
+      }
+      return UNDEFINED;
+    }
+
+    size_t find_or_add_R_class(element_type const& x) {
+      size_t const r = find_R_class(x);
+      if (r != UNDEFINED) {
+        return r;
+      }
+      LIBSEMIGROUPS_ASSERT(_lambda_orb.position(_tmp_lambda) != UNDEFINED);
+      LIBSEMIGROUPS_ASSERT(_rho_orb.position(_tmp_rho) != UNDEFINED);
+      size_t const scc
+          = _lambda_orb.digraph().scc_id(_lambda_orb.position(_tmp_lambda));
+      size_t const rpos = _rho_orb.position(_tmp_rho);
+      _reps.push_back(_tmp_element2);
+      _reps_lambda_scc.push_back(scc);
+      _reps_rho_pos.push_back(rpos);
+      _reps_lookup[key(scc, rpos)].push_back(_reps.size() - 1);
+      _graph.add_nodes(1);
+      group(scc);
+      return _reps.size() - 1;
+    }
+
+    size_t key(size_t lambda_scc, size_t rho_pos) const {
+      return rho_pos * _groups.size() + lambda_scc;
+    }
+
+    ////////////////////////////////////////////////////////////////////////
+    // Konieczny - data members - private
+    ////////////////////////////////////////////////////////////////////////
+
+    size_t                                           _degree;
+    std::vector<element_type>                        _gens;
+    ActionDigraph<size_t>                            _graph;
+    std::vector<std::unique_ptr<group_type>>         _groups;
+    bool                                             _init;
+    lambda_orb_type                                  _lambda_orb;
+    std::vector<element_type>                        _lambda_to_root;
+    std::vector<bool>                                _lambda_to_root_defined;
+    size_t                                           _pos;
+    std::vector<element_type>                        _reps;
+    std::vector<size_t>                              _reps_lambda_scc;
+    std::unordered_map<size_t, std::vector<size_t>>  _reps_lookup;
+    std::vector<size_t>                              _reps_rho_pos;
+    rho_orb_type                                     _rho_orb;
+    element_type                                     _tmp_element1;
+    element_type                                     _tmp_element2;
+    lambda_value_type                                _tmp_lambda;
+    rho_value_type                                   _tmp_rho;
+  };
+}  // namespace libsemigroups
+
+#endif  // LIBSEMIGROUPS_INCLUDE_KONIECZNY_HPP_
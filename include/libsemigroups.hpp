@@ -23,6 +23,7 @@
 
 #include "action.hpp"
 #include "adapters.hpp"
+#include "binary-io.hpp"
 #include "blocks.hpp"
 #include "bmat8.hpp"
 #include "bruidhinn-traits.hpp"
@@ -41,12 +42,14 @@
 #include "fpsemi.hpp"
 #include "froidure-pin-base.hpp"
 #include "froidure-pin.hpp"
+#include "froidure-pin-view.hpp"
 #include "function-ref.hpp"
 #include "hpcombi.hpp"
 #include "int-range.hpp"
 #include "iterator.hpp"
 #include "kbe.hpp"
 #include "knuth-bendix.hpp"
+#include "konieczny.hpp"
 #include "libsemigroups-config.hpp"
 #include "libsemigroups-debug.hpp"
 #include "libsemigroups-exception.hpp"
@@ -0,0 +1,116 @@
+//
+// libsemigroups - C++ library for semigroups and monoids
+// Copyright (C) 2019 James D. Mitchell
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+// This file contains the declaration of the class detail::MmapAllocator,
+// which is used by ToddCoxeter to store its coset tables in files.
+
+#ifndef LIBSEMIGROUPS_INCLUDE_MMAP_ALLOCATOR_HPP_
+#define LIBSEMIGROUPS_INCLUDE_MMAP_ALLOCATOR_HPP_
+
+#include <cstddef>      // for size_t
+#include <new>          // for operator new, operator delete
+#include <string>       // for string
+#include <type_traits>  // for true_type, false_type
+
+namespace libsemigroups {
+  namespace detail {
+    // Maps a new file of nr_bytes bytes in the directory dir into memory,
+    // read-write and shared, and returns a pointer to the start of the
+    // mapping. The file is removed before this function returns, and so its
+    // space is reclaimed when the mapping is removed by mmap_deallocate.
+    void* mmap_allocate(std::string const& dir, size_t nr_bytes);
+
+    // Removes the mapping of nr_bytes bytes starting at ptr, which must have
+    // been returned by mmap_allocate.
+    void mmap_deallocate(void* ptr, size_t nr_bytes) noexcept;
+
+    // An allocator that either allocates memory in the usual way, if the
+    // directory it is constructed with is empty, or otherwise maps a new file
+    // in that directory into memory for every allocation. The pages of such a
+    // mapping are backed by the file, and so the operating system can write
+    // them to the file and drop them from memory when memory is short, and
+    // read them again when they are used, unlike pages of memory allocated in
+    // the usual way (which can only be swapped, if there is any swap space).
+    //
+    // Two MmapAllocators are equal if and only if they have the same
+    // directory, and the allocator of a container is propagated by copy and
+    // move assignment and by swap, so that memory is always deallocated in the
+    // same way that it was allocated.
+    template <typename T>
+    class MmapAllocator {
+      template <typename S>
+      friend class MmapAllocator;
+
+     public:
+      using value_type                             = T;
+      using propagate_on_container_copy_assignment = std::true_type;
+      using propagate_on_container_move_assignment = std::true_type;
+      using propagate_on_container_swap            = std::true_type;
+      using is_always_equal                        = std::false_type;
+
+      MmapAllocator() : _dir() {}
+
+      explicit MmapAllocator(std::string const& dir) : _dir(dir) {}
+
+      template <typename S>
+      MmapAllocator(MmapAllocator<S> const& that) : _dir(that._dir) {}
+
+      MmapAllocator(MmapAllocator const&) = default;
+      MmapAllocator(MmapAllocator&&)      = default;
+      MmapAllocator& operator=(MmapAllocator const&) = default;
+      MmapAllocator& operator=(MmapAllocator&&) = default;
+
+      ~MmapAllocator() = default;
+
+      // Returns the directory containing the files, or the empty string if
+      // memory is allocated in the usual way.
+      std::string const& directory() const noexcept {
+        return _dir;
+      }
+
+      T* allocate(size_t n) {
+        if (_dir.empty()) {
+          return static_cast<T*>(::operator new(n * sizeof(T)));
+        }
+        return static_cast<T*>(mmap_allocate(_dir, n * sizeof(T)));
+      }
+
+      void deallocate(T* ptr, size_t n) noexcept {
+        if (_dir.empty()) {
+          ::operator delete(ptr);
+        } else {
+          mmap_deallocate(ptr, n * sizeof(T));
+        }
+      }
+
+      template <typename S>
+      bool operator==(MmapAllocator<S> const& that) const noexcept {
+        return _dir == that._dir;
+      }
+
+      template <typename S>
+      bool operator!=(MmapAllocator<S> const& that) const noexcept {
+        return _dir != that._dir;
+      }
+
+     private:
+      std::string _dir;
+    };
+  }  // namespace detail
+}  // namespace libsemigroups
+#endif  // LIBSEMIGROUPS_INCLUDE_MMAP_ALLOCATOR_HPP_
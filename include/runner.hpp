@@ -271,6 +271,22 @@ namespace libsemigroups {
       report_every(std::chrono::nanoseconds(t));
     }
 
+    //! Get the minimum elapsed time between reports.
+    //!
+    //! \returns
+    //! A std::chrono::nanoseconds.
+    //!
+    //! \exceptions
+    //! \noexcept
+    //!
+    //! \par Parameters
+    //! (None)
+    //!
+    //! \sa report_every(std::chrono::nanoseconds)
+    std::chrono::nanoseconds report_every() const noexcept {
+      return _report_time_interval;
+    }
+
     //! Report why Runner::run stopped.
     //!
     //! Reports whether Runner::run was stopped because it is Runner::finished,
@@ -0,0 +1,82 @@
+//
+// libsemigroups - C++ library for semigroups and monoids
+// Copyright (C) 2019 James D. Mitchell
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+// This file contains the declaration of the class detail::SpillFile, which
+// is used by FroidurePin to move elements out of memory and into a file.
+
+#ifndef LIBSEMIGROUPS_INCLUDE_SPILL_FILE_HPP_
+#define LIBSEMIGROUPS_INCLUDE_SPILL_FILE_HPP_
+
+#include <cstddef>  // for size_t
+#include <string>   // for string
+
+namespace libsemigroups {
+  namespace detail {
+    // A file that can only be appended to, and whose contents are mapped
+    // read-only into memory. The pages of the mapping are backed by the file,
+    // and so the operating system can drop them from memory and read them
+    // again when required, unlike pages of memory allocated in the usual way.
+    // The file is created (or truncated) by the constructor, and removed by
+    // the destructor.
+    class SpillFile final {
+     public:
+      explicit SpillFile(std::string const& path);
+
+      SpillFile(SpillFile const&) = delete;
+      SpillFile(SpillFile&&)      = delete;
+      SpillFile& operator=(SpillFile const&) = delete;
+      SpillFile& operator=(SpillFile&&) = delete;
+
+      ~SpillFile();
+
+      // Returns the name of the file.
+      std::string const& path() const noexcept {
+        return _path;
+      }
+
+      // Returns the number of bytes written to the file.
+      size_t size() const noexcept {
+        return _size;
+      }
+
+      // Returns a pointer to the start of the mapping of the file, which is
+      // only valid until the next call to map, and only contains the bytes
+      // written before that call.
+      char const* data() const noexcept {
+        return _data;
+      }
+
+      // Appends nr bytes starting at ptr to the end of the file. The new
+      // bytes are not accessible through data until map is called.
+      void write(void const* ptr, size_t nr);
+
+      // Maps the entire file into memory, replacing any previous mapping.
+      void map();
+
+     private:
+      void unmap() noexcept;
+
+      char*       _data;
+      int         _fd;
+      size_t      _mapped;
+      std::string _path;
+      size_t      _size;
+    };
+  }  // namespace detail
+}  // namespace libsemigroups
+#endif  // LIBSEMIGROUPS_INCLUDE_SPILL_FILE_HPP_
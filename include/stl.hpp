@@ -22,8 +22,11 @@
 #ifndef LIBSEMIGROUPS_INCLUDE_STL_HPP_
 #define LIBSEMIGROUPS_INCLUDE_STL_HPP_
 
+#include <algorithm>    // for sort, inplace_merge
 #include <cstddef>      // for size_t
+#include <iterator>     // for distance
 #include <memory>       // for unique_ptr
+#include <thread>       // for thread
 #include <type_traits>  // for enable_if, forward, hash, is_function, is_same
 #include <vector>       // for vector
 
@@ -46,6 +49,59 @@ namespace libsemigroups {
       }
     }
 
+    // Sorts the range [first, last) using up to nr_threads threads. The range
+    // is split into nr_threads blocks of (almost) equal size which are sorted
+    // concurrently, and then pairs of adjacent blocks are merged concurrently,
+    // halving the number of blocks every time, until there is one block left.
+    template <typename TIterator, typename TCompare>
+    void parallel_sort(TIterator first,
+                       TIterator last,
+                       TCompare  comp,
+                       size_t    nr_threads) {
+      size_t const n = std::distance(first, last);
+      if (nr_threads <= 1 || n < 2 * nr_threads) {
+        std::sort(first, last, comp);
+        return;
+      }
+      std::vector<TIterator> bounds;
+      for (size_t i = 0; i <= nr_threads; ++i) {
+        bounds.push_back(first + (i * n) / nr_threads);
+      }
+      std::vector<std::thread> threads;
+      for (size_t i = 0; i < nr_threads; ++i) {
+        threads.emplace_back(
+            [&comp](TIterator f, TIterator l) { std::sort(f, l, comp); },
+            bounds[i],
+            bounds[i + 1]);
+      }
+      for (auto& thread : threads) {
+        thread.join();
+      }
+      while (bounds.size() > 2) {
+        threads.clear();
+        std::vector<TIterator> next;
+        for (size_t i = 0; i + 2 < bounds.size(); i += 2) {
+          threads.emplace_back(
+              [&comp](TIterator f, TIterator m, TIterator l) {
+                std::inplace_merge(f, m, l, comp);
+              },
+              bounds[i],
+              bounds[i + 1],
+              bounds[i + 2]);
+          next.push_back(bounds[i]);
+        }
+        if (bounds.size() % 2 == 0) {
+          // The number of blocks is odd, and the last one is not merged.
+          next.push_back(bounds[bounds.size() - 2]);
+        }
+        next.push_back(bounds.back());
+        for (auto& thread : threads) {
+          thread.join();
+        }
+        bounds = std::move(next);
+      }
+    }
+
     // C++11 is missing make_unique. The following implementation is from Item
     // 21 in "Effective Modern C++" by Scott Meyers.
     template <typename T, typename... Ts>
@@ -53,6 +109,13 @@ namespace libsemigroups {
       return std::unique_ptr<T>(new T(std::forward<Ts>(params)...));
     }
 
+    // C++11 is missing void_t, which is introduced in C++17, and so we use
+    // MakeVoid<Ts...>::type instead.
+    template <typename... Ts>
+    struct MakeVoid {
+      using type = void;
+    };
+
     // Since std::is_invocable is only introduced in C++17, we use this
     // from: https://stackoverflow.com/q/15393938/
     // Only works if there are no overloads of operator() in type T.
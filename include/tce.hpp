@@ -33,6 +33,7 @@
 #include "adapters.hpp"    // for Complexity, Degree, Less, One, Product, ...
 #include "constants.hpp"   // for LIMIT_MAX
 #include "containers.hpp"  // for DynamicArray2
+#include "types.hpp"       // for table_index_type
 
 namespace libsemigroups {
   // Forward declarations
@@ -50,7 +51,7 @@ namespace libsemigroups {
 
      public:
       // The type of the wrapped indices.
-      using class_index_type = size_t;
+      using class_index_type = table_index_type;
 
       // The type of the underlying coset table produced by an instance of
       // ToddCoxeter.
@@ -27,6 +27,7 @@
 #include <memory>   // for shared_ptr
 #include <numeric>  // for std::iota
 #include <stack>    // for stack
+#include <string>   // for string
 #include <utility>  // for pair
 #include <vector>   // for vector
 
@@ -37,6 +38,7 @@
 #include "int-range.hpp"            // for IntegralRange
 #include "iterator.hpp"             // for ConstIteratorStateful
 #include "libsemigroups-debug.hpp"  // for LIBSEMIGROUPS_ASSERT
+#include "mmap-allocator.hpp"       // for MmapAllocator
 #include "order.hpp"                // shortlex_compare
 #include "report.hpp"               // for REPORT
 #include "string.hpp"               // for to_string
@@ -45,6 +47,7 @@
 namespace libsemigroups {
   // Forward declarations
   namespace detail {
+    class Race;
     class TCE;
   }
   class FroidurePinBase;
@@ -153,6 +156,11 @@ namespace libsemigroups {
       ////////////////////////////////////////////////////////////////////////
 
       using Table = detail::DynamicArray2<class_index_type>;
+      // The type of _table, _preim_init, and _preim_next, whose memory is
+      // allocated in files if ToddCoxeter::table_directory is not empty.
+      using InternalTable
+          = detail::DynamicArray2<class_index_type,
+                                  detail::MmapAllocator<class_index_type>>;
 
       // Forward declared
       struct NormalFormIteratorTraits;
@@ -211,7 +219,28 @@ namespace libsemigroups {
           //! and this strategy is then run for approximately the amount
           //! of time specified by the setting random_interval. This strategy is
           //! inspired by Sim's TEN_CE from [Sim94](../biblio.html#sims1994aa).
-          random
+          random,
+          //! This value indicates that several combinations of the HLT and
+          //! Felsch strategies should be run concurrently, each on its own
+          //! copy of this, and that the coset table of whichever finishes
+          //! first should be adopted (without being copied). The
+          //! combinations are, in order:
+          //! 1. HLT + partial lookahead + no deduction processing
+          //! 2. Felsch
+          //! 3. HLT + full lookahead + deduction processing
+          //! 4. HLT + full lookahead + no deduction processing
+          //! 5. HLT + partial lookahead + deduction processing
+          //!
+          //! and only the first ToddCoxeter::max_threads of these (that are
+          //! possible for this) are used. If ToddCoxeter::max_threads is \c
+          //! 1, then this is the same as policy::strategy::hlt. If this is
+          //! stopped before any of the combinations finishes, then they are
+          //! resumed the next time this is run, but any progress they have
+          //! made is not reflected in this (or in any checkpoint) until one
+          //! of them finishes. Every combination keeps its own full copy of
+          //! the coset table and its preimages, and so up to 5 copies exist
+          //! at once while this strategy runs.
+          portfolio
         };
 
         //! The values in this enum can be used as the argument for
@@ -225,7 +254,15 @@ namespace libsemigroups {
           //! A *partial* lookahead is one starting from the current coset.
           //! Partial lookaheads are therefore sometimes faster but may not
           //! detect as many coincidences as a full lookahead.
-          partial
+          partial,
+          //! A *parallel* lookahead is a full lookahead where the active
+          //! cosets are divided between (at most) ToddCoxeter::max_threads
+          //! threads. Each thread traces the relations at its cosets without
+          //! modifying the coset table, and records any coincidences, and any
+          //! undefined values in the coset table implied by the relations,
+          //! that it finds. These are then processed by a single thread, and
+          //! this is repeated until nothing further is found.
+          parallel
         };
 
         //! The values in this enum can be used as the argument for
@@ -251,6 +288,39 @@ namespace libsemigroups {
           //! Use the left or right Cayley graph of a FroidurePin instance
           use_cayley_graph
         };
+
+        //! The values in this enum can be used as the argument for
+        //! ToddCoxeter::deduction_policy to specify what should happen when
+        //! the number of deductions waiting to be processed exceeds
+        //! ToddCoxeter::max_deductions. These are modelled on the options
+        //! for the deduction stack in ACE.
+        //!
+        //! If any deductions are discarded, then a full lookahead is
+        //! performed (repeatedly, until no further cosets are killed) at the
+        //! end of a Felsch style enumeration, to recover any coincidences
+        //! that would otherwise have been missed.
+        enum class deductions {
+          //! There is no limit on the number of deductions that are stacked.
+          unlimited,
+          //! Deductions for cosets that are no longer active are removed from
+          //! the stack, and if the stack is still too large, then the most
+          //! recent deductions are discarded until it is not.
+          purge_from_top,
+          //! Deductions for cosets that are no longer active are removed from
+          //! the stack, and if the stack is still too large, then all of the
+          //! deductions are discarded.
+          purge_all,
+          //! All of the deductions are discarded.
+          discard_all_if_no_space,
+          //! All of the deductions are discarded, and the enumeration
+          //! continues using the HLT strategy. The value of
+          //! ToddCoxeter::strategy is not changed, and the HLT strategy is
+          //! used until the enumeration is finished, or until
+          //! ToddCoxeter::strategy is called again. When using the HLT
+          //! strategy with ToddCoxeter::save, this is the same as
+          //! discard_all_if_no_space.
+          switch_to_hlt
+        };
       };
 
       //! The values in this enum can be used as the argument for
@@ -404,6 +474,99 @@ namespace libsemigroups {
       //! \sa ToddCoxeter::policy::lookahead.
       ToddCoxeter& lookahead(policy::lookahead) noexcept;
 
+      //! Sets the maximum number of threads to be used in a lookahead of type
+      //! policy::lookahead::parallel, and the maximum number of combinations
+      //! run concurrently by policy::strategy::portfolio. The actual number
+      //! of threads used is the minimum of the argument and \c
+      //! std::thread::hardware_concurrency, and if the argument is \c 0, then
+      //! \c 1 thread is used. If only \c 1 thread is used, then
+      //! policy::strategy::portfolio is the same as policy::strategy::hlt.
+      //!
+      //! The default value is \c std::thread::hardware_concurrency.
+      ToddCoxeter& max_threads(size_t) noexcept;
+
+      //! Gets the current value of the maximum number of threads.
+      //!
+      //! \sa max_threads(size_t)
+      size_t max_threads() const noexcept;
+
+      //! The coset table is compacted during the enumeration if the
+      //! proportion of its rows occupied by active cosets falls below the
+      //! value set by this function (and sufficiently many cosets have been
+      //! killed since the last compaction). Compacting the table relocates
+      //! the active cosets so that they occupy a contiguous range at the start
+      //! of the table. This makes subsequent scans of the table more cache
+      //! friendly after a large collapse, and means that
+      //! ToddCoxeter::shrink_to_fit does not have to standardize the table.
+      //!
+      //! The table is never compacted during the enumeration if the argument
+      //! is \c 0, or if ToddCoxeter::standardize(bool) was called with
+      //! argument \c true.
+      //!
+      //! The default value is \c 0.25.
+      ToddCoxeter& compaction_ratio(float) noexcept;
+
+      //! Gets the current value of the compaction ratio.
+      //!
+      //! \sa compaction_ratio(float)
+      float compaction_ratio() const noexcept;
+
+      //! If the argument is not empty, then the coset table and the tables
+      //! of preimages used in the enumeration are stored in files in the
+      //! directory \p dir, which are mapped into memory, rather than in
+      //! memory allocated in the usual way. The operating system can then
+      //! write the pages of these tables to the files, and drop them from
+      //! memory, when memory is short, and so an enumeration whose tables do
+      //! not fit in memory runs at the speed of the disk rather than failing.
+      //! The files are removed from \p dir as soon as they are created, and
+      //! so they do not appear in \p dir, and their space on disk is
+      //! reclaimed when \c this is destroyed, even if the program does not
+      //! exit normally. If the argument is empty, then the tables are copied
+      //! back into memory allocated in the usual way.
+      //!
+      //! This function can be called at any time, including between calls to
+      //! Runner::run_for, and the tables are moved immediately. Copies of \c
+      //! this store their tables in the same way as \c this.
+      //!
+      //! The default value is the empty string.
+      //!
+      //! \throws LibsemigroupsException if a file cannot be created in \p
+      //! dir, in which case \c this is not modified.
+      ToddCoxeter& table_directory(std::string const& dir);
+
+      //! Gets the name of the directory used to store the tables.
+      //!
+      //! \sa table_directory(std::string const&)
+      std::string const& table_directory() const noexcept;
+
+      //! Sets the policy used when the number of deductions waiting to be
+      //! processed exceeds ToddCoxeter::max_deductions. This only applies
+      //! when using the Felsch strategy, or the HLT strategy with
+      //! ToddCoxeter::save.
+      //!
+      //! The default value is policy::deductions::unlimited.
+      //!
+      //! \sa ToddCoxeter::policy::deductions.
+      ToddCoxeter& deduction_policy(policy::deductions) noexcept;
+
+      //! Gets the current value of the deduction policy.
+      //!
+      //! \sa deduction_policy(policy::deductions)
+      policy::deductions deduction_policy() const noexcept;
+
+      //! Sets the maximum number of deductions that can be waiting to be
+      //! processed before the deduction policy is applied. If the deduction
+      //! policy is policy::deductions::unlimited, then the value of this
+      //! setting is ignored.
+      //!
+      //! The default value is 100000.
+      ToddCoxeter& max_deductions(size_t) noexcept;
+
+      //! Gets the current value of the maximum number of deductions.
+      //!
+      //! \sa max_deductions(size_t)
+      size_t max_deductions() const noexcept;
+
       //! Sets a lower bound for the number of classes of the congruence
       //! represented by a ToddCoxeter instance. If
       //! ToddCoxeter::nr_cosets_active becomes at least the value of the
@@ -542,6 +705,52 @@ namespace libsemigroups {
       //! nothing.
       void shrink_to_fit();
 
+      ////////////////////////////////////////////////////////////////////////
+      // ToddCoxeter - member functions (checkpointing) - public
+      ////////////////////////////////////////////////////////////////////////
+
+      //! Writes the current state of the coset enumeration to the file \p
+      //! path. This includes the coset table, the relations and generating
+      //! pairs, the settings, and any coincidences or deductions waiting to
+      //! be processed. The file is first written to \p path with the suffix
+      //! \c ".tmp" and then renamed, so that \p path is never left partially
+      //! written.
+      //!
+      //! \throws LibsemigroupsException if the file cannot be written.
+      //!
+      //! \sa load_checkpoint and checkpoint(std::string const&).
+      void save_checkpoint(std::string const& path) const;
+
+      //! Replaces the state of the coset enumeration by that in the file \p
+      //! path, which must have been written by save_checkpoint. After calling
+      //! this function, ToddCoxeter::run continues the enumeration from where
+      //! it was when the file was written. The settings of \c this are
+      //! replaced by those in the file.
+      //!
+      //! \c this must be of the same kind, and have the same number of
+      //! generators and the same generating pairs, as the instance that wrote
+      //! the file.
+      //!
+      //! \throws LibsemigroupsException if started() returns \c true, if the
+      //! file cannot be read or was not written by save_checkpoint, or if the
+      //! file was written by an instance that is not compatible with \c this.
+      //! In any of these cases, \c this is not modified.
+      void load_checkpoint(std::string const& path);
+
+      //! If the argument is not empty, then save_checkpoint is called with
+      //! this argument every time that Runner::report returns \c true during
+      //! the HLT or Felsch strategies. The frequency of the checkpoints can
+      //! therefore be set using Runner::report_every. If the argument is
+      //! empty, then no automatic checkpoints are written.
+      //!
+      //! The default value is the empty string.
+      ToddCoxeter& checkpoint(std::string const&);
+
+      //! Gets the name of the file used for automatic checkpoints.
+      //!
+      //! \sa checkpoint(std::string const&)
+      std::string const& checkpoint() const noexcept;
+
       ////////////////////////////////////////////////////////////////////////
       // ToddCoxeter - member functions (state) - public
       ////////////////////////////////////////////////////////////////////////
@@ -623,7 +832,8 @@ namespace libsemigroups {
       // ToddCoxeter - member functions (validation) - private
       ////////////////////////////////////////////////////////////////////////
 
-      void validate_table(Table const&, size_t const, size_t const) const;
+      template <typename T>
+      void validate_table(T const&, size_t const, size_t const) const;
 
       ////////////////////////////////////////////////////////////////////////
       // ToddCoxeter - member functions (initialisation) - private
@@ -649,6 +859,7 @@ namespace libsemigroups {
 
       void make_deductions_dfs(coset_type const);
       void process_deductions();
+      void limit_deductions();
 
       inline coset_type tau(coset_type const c, letter_type const a) const
           noexcept {
@@ -782,9 +993,8 @@ namespace libsemigroups {
           coset_type min = find_coset(c.first);
           coset_type max = find_coset(c.second);
           if (min != max) {
-            if (min > max) {
-              std::swap(min, max);
-            }
+            // Kills one of <min> and <max>, after this <max> is the coset that
+            // was killed.
             union_cosets(min, max);
 
             size_t const n = _table.nr_cols();
@@ -849,9 +1059,18 @@ namespace libsemigroups {
 
       void felsch();
       void hlt();
+      void portfolio();
       void sims();
 
       void perform_lookahead();
+      bool compaction_due() const noexcept;
+      void compact();
+      void auto_checkpoint();
+      void lookahead_scan(std::vector<coset_type> const&,
+                          size_t,
+                          size_t,
+                          bool,
+                          std::vector<std::pair<coset_type, size_t>>&) const;
 
       ////////////////////////////////////////////////////////////////////////
       // ToddCoxeter - member functions (standardize) - private
@@ -931,6 +1150,18 @@ namespace libsemigroups {
       using Deduction   = std::pair<coset_type, letter_type>;
       using Tree        = std::vector<TreeNode>;
 
+      // A frame in the explicit stack used by make_deductions_dfs: the coset
+      // <coset>, the generator <gen> whose preimages are being visited, and
+      // the current such preimage <preim> (or UNDEFINED if <gen> has not
+      // been entered yet).
+      struct DFSFrame {
+        DFSFrame(coset_type c, letter_type x, coset_type e)
+            : coset(c), gen(x), preim(e) {}
+        coset_type  coset;
+        letter_type gen;
+        coset_type  preim;
+      };
+
       ////////////////////////////////////////////////////////////////////////
       // ToddCoxeter - enums - private
       ////////////////////////////////////////////////////////////////////////
@@ -948,20 +1179,26 @@ namespace libsemigroups {
       // ToddCoxeter - data - private
       ////////////////////////////////////////////////////////////////////////
 
-      std::stack<Coincidence>     _coinc;
-      std::stack<Deduction>       _deduct;
-      std::vector<word_type>      _extra;
-      std::unique_ptr<FelschTree> _felsch_tree;
-      size_t                      _nr_pairs_added_earlier;
-      bool                        _prefilled;
-      Table                       _preim_init;
-      Table                       _preim_next;
-      std::vector<word_type>      _relations;
-      std::unique_ptr<Settings>   _settings;
-      order                       _standardized;
-      state                       _state;
-      Table                       _table;
-      std::unique_ptr<Tree>       _tree;
+      std::string                   _checkpoint;
+      std::stack<Coincidence>       _coinc;
+      std::vector<Deduction>        _deduct;
+      bool                          _deductions_discarded;
+      std::vector<DFSFrame>         _dfs;
+      std::vector<word_type>        _extra;
+      std::unique_ptr<FelschTree>   _felsch_tree;
+      size_t                        _nr_killed_at_compaction;
+      size_t                        _nr_pairs_added_earlier;
+      std::unique_ptr<detail::Race> _portfolio;
+      bool                          _prefilled;
+      InternalTable                 _preim_init;
+      InternalTable                 _preim_next;
+      std::vector<word_type>        _relations;
+      std::unique_ptr<Settings>     _settings;
+      order                         _standardized;
+      state                         _state;
+      bool                          _switched_to_hlt;
+      InternalTable                 _table;
+      std::unique_ptr<Tree>         _tree;
     };
 
   }  // namespace congruence
@@ -26,6 +26,8 @@
 #include <utility>      // for pair
 #include <vector>       // for vector
 
+#include "libsemigroups-config.hpp"  // for LIBSEMIGROUPS_COMPACT_INDEX
+
 namespace libsemigroups {
   //! The values in this enum can be used to indicate a result is true, false,
   //! or not currently knowable.
@@ -66,6 +68,16 @@ namespace libsemigroups {
 
   //! Type for a pair of word_type (a *relation*) of a semigroup.
   using relation_type = std::pair<word_type, word_type>;
+
+  //! Type for the entries in the Cayley graphs of a FroidurePin and the coset
+  //! tables of a congruence::ToddCoxeter. This is \c uint32_t if
+  //! libsemigroups was configured with \c --enable-compact-index, which
+  //! halves the memory used by these tables, and \c size_t otherwise.
+#ifdef LIBSEMIGROUPS_COMPACT_INDEX
+  using table_index_type = uint32_t;
+#else
+  using table_index_type = size_t;
+#endif
 }  // namespace libsemigroups
 
 #endif  // LIBSEMIGROUPS_INCLUDE_TYPES_HPP_
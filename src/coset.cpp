@@ -22,10 +22,16 @@
 #include "coset.hpp"
 
 #include <cstddef>  // for size_t
+#include <istream>  // for istream
 #include <numeric>  // for iota
+#include <ostream>  // for ostream
+#include <utility>  // for swap
+#include <vector>   // for vector
 
-#include "libsemigroups-debug.hpp"  // for LIBSEMIGROUPS_ASSERT
-#include "report.hpp"               // for REPORT_DEBUG
+#include "binary-io.hpp"                // for read_binary, write_binary
+#include "libsemigroups-debug.hpp"      // for LIBSEMIGROUPS_ASSERT
+#include "libsemigroups-exception.hpp"  // for LIBSEMIGROUPS_EXCEPTION
+#include "report.hpp"                   // for REPORT_DEBUG
 
 ////////////////////////////////////////////////////////////////////////////////
 //
@@ -41,7 +47,15 @@
 //
 // If c is an active coset, then _ident[c] = c.
 //
-// If c is a free coset, then _ident[c] != c.
+// If c is a free coset, then _ident[c] != c. If c was killed by identifying
+// it with another coset d, then _ident[c] is a "forwarding address": following
+// _ident from c leads to the active coset that c is now identified with.
+// These chains are shortened by CosetManager::find_coset (path halving).
+//
+// If c is an active coset, then _rank[c] is an upper bound for the length of
+// the longest chain of forwarding addresses ending at c, and is used by
+// CosetManager::union_cosets to decide which of two cosets is killed (union by
+// rank).
 //
 // We also store some special locations in the list:
 //
@@ -96,9 +110,10 @@ namespace libsemigroups {
           _cosets_killed(0),
           _defined(1),
           _first_free_coset(UNDEFINED),
-          _forwd(1, static_cast<size_t>(UNDEFINED)),
+          _forwd(1, static_cast<coset_type>(UNDEFINED)),
           _ident(1, 0),
-          _last_active_coset(0) {}
+          _last_active_coset(0),
+          _rank(1, 0) {}
 
     ////////////////////////////////////////////////////////////////////////
     // CosetManager - member functions - protected
@@ -125,6 +140,7 @@ namespace libsemigroups {
         _last_active_coset         = _first_free_coset;
         _first_free_coset          = _forwd[_last_active_coset];
         _ident[_last_active_coset] = _last_active_coset;
+        _rank[_last_active_coset]  = 0;
       }
     }
 
@@ -146,6 +162,7 @@ namespace libsemigroups {
       std::iota(_bckwd.begin() + old_capacity + 1, _bckwd.end(), old_capacity);
 
       _ident.resize(_ident.size() + n, 0);
+      _rank.resize(_rank.size() + n, 0);
 
       _first_free_coset          = old_capacity;
       _forwd[_last_active_coset] = _first_free_coset;
@@ -183,6 +200,8 @@ namespace libsemigroups {
       _bckwd.shrink_to_fit();
       _ident.erase(_ident.begin() + nr_cosets_active(), _ident.end());
       _ident.shrink_to_fit();
+      _rank.erase(_rank.begin() + nr_cosets_active(), _rank.end());
+      _rank.shrink_to_fit();
 #ifdef LIBSEMIGROUPS_DEBUG
       debug_validate_forwd_bckwd();
 #endif
@@ -234,6 +253,7 @@ namespace libsemigroups {
         _ident[c] = 0;
         _ident[d] = d;
       }
+      std::swap(_rank[c], _rank[d]);
 
       _current           = ff(c, d, _current);
       _last_active_coset = ff(c, d, _last_active_coset);
@@ -246,6 +266,121 @@ namespace libsemigroups {
       LIBSEMIGROUPS_ASSERT(!is_active_coset(_first_free_coset));
     }
 
+    void CosetManager::write_cosets(std::ostream& os) const {
+      write_binary(os, _current);
+      write_binary(os, _current_la);
+      write_binary(os, _active);
+      write_binary(os, _bckwd);
+      write_binary(os, _cosets_killed);
+      write_binary(os, _defined);
+      write_binary(os, _first_free_coset);
+      write_binary(os, _forwd);
+      write_binary(os, _ident);
+      write_binary(os, _last_active_coset);
+      write_binary(os, _rank);
+    }
+
+    void CosetManager::read_cosets(std::istream& is, size_t n) {
+      coset_type              current, current_la, first_free, last_active;
+      size_t                  active, cosets_killed, defined;
+      std::vector<coset_type> bckwd, forwd, ident;
+      std::vector<uint8_t>    rank;
+
+      read_binary(is, current);
+      read_binary(is, current_la);
+      read_binary(is, active);
+      read_binary(is, bckwd);
+      read_binary(is, cosets_killed);
+      read_binary(is, defined);
+      read_binary(is, first_free);
+      read_binary(is, forwd);
+      read_binary(is, ident);
+      read_binary(is, last_active);
+      read_binary(is, rank);
+
+      auto valid = [&n](coset_type c) {
+        return c < n || c == static_cast<coset_type>(UNDEFINED);
+      };
+      if (n == 0 || forwd.size() != n || bckwd.size() != n || ident.size() != n
+          || rank.size() != n || active == 0 || active > n || last_active >= n
+          || !valid(current) || !valid(current_la) || !valid(first_free)) {
+        LIBSEMIGROUPS_EXCEPTION("invalid coset data");
+      }
+      // forwd and bckwd must link every coset into a single list, in which
+      // the active cosets precede first_free, and following ident from any
+      // coset must lead to an active coset.
+      size_t     nr_seen = 0, nr_active = 0;
+      coset_type last    = _id_coset;
+      bool       is_free = false;
+      for (coset_type c = _id_coset, prev = _id_coset; c != UNDEFINED;
+           prev = c, c = forwd[c]) {
+        if (c >= n || nr_seen == n || bckwd[c] != prev || ident[c] >= n) {
+          LIBSEMIGROUPS_EXCEPTION("invalid coset data");
+        }
+        is_free = is_free || c == first_free;
+        if (is_free == (ident[c] == c)) {
+          LIBSEMIGROUPS_EXCEPTION("invalid coset data");
+        } else if (!is_free) {
+          last = c;
+          nr_active++;
+        }
+        nr_seen++;
+      }
+      // _current and _current_la must be active, or the first free coset
+      // when a loop over the active cosets has finished.
+      auto active_or_first_free = [&](coset_type c) {
+        return c == first_free || (c != UNDEFINED && ident[c] == c);
+      };
+      if (nr_seen != n || nr_active != active || last != last_active
+          || (first_free == UNDEFINED) != (nr_active == n)
+          || !active_or_first_free(current)
+          || !active_or_first_free(current_la)) {
+        LIBSEMIGROUPS_EXCEPTION("invalid coset data");
+      }
+      std::vector<bool> leads_to_active(n, false);
+      for (coset_type c = 0; c < n; ++c) {
+        coset_type d = c;
+        for (size_t k = 0; !leads_to_active[d] && ident[d] != d; ++k) {
+          if (k == n) {
+            LIBSEMIGROUPS_EXCEPTION("invalid coset data");
+          }
+          d = ident[d];
+        }
+        for (d = c; !leads_to_active[d]; d = ident[d]) {
+          leads_to_active[d] = true;
+        }
+      }
+
+      _current           = current;
+      _current_la        = current_la;
+      _active            = active;
+      _bckwd             = std::move(bckwd);
+      _cosets_killed     = cosets_killed;
+      _defined           = defined;
+      _first_free_coset  = first_free;
+      _forwd             = std::move(forwd);
+      _ident             = std::move(ident);
+      _last_active_coset = last_active;
+      _rank              = std::move(rank);
+#ifdef LIBSEMIGROUPS_DEBUG
+      debug_validate_forwd_bckwd();
+#endif
+    }
+
+    void CosetManager::swap_cosets(CosetManager& that) noexcept {
+      std::swap(_current, that._current);
+      std::swap(_current_la, that._current_la);
+      std::swap(_active, that._active);
+      _bckwd.swap(that._bckwd);
+      std::swap(_cosets_killed, that._cosets_killed);
+      std::swap(_defined, that._defined);
+      std::swap(_first_free_coset, that._first_free_coset);
+      _forwd.swap(that._forwd);
+      _ident.swap(that._ident);
+      std::swap(_last_active_coset, that._last_active_coset);
+      _rank.swap(that._rank);
+    }
+
     ////////////////////////////////////////////////////////////////////////
     // CosetManager - member functions - private
     ////////////////////////////////////////////////////////////////////////
@@ -18,11 +18,53 @@
 
 #include "froidure-pin-base.hpp"
 
-#include <vector>
+#include <cstdio>   // for rename
+#include <fstream>  // for ifstream, ofstream
+#include <ostream>  // for ostream
+#include <sstream>  // for ostringstream
+#include <vector>   // for vector
 
-#include "libsemigroups-exception.hpp"
+#include "binary-io.hpp"                // for read_varint, write_varint
+#include "libsemigroups-debug.hpp"      // for LIBSEMIGROUPS_ASSERT
+#include "libsemigroups-exception.hpp"  // for LIBSEMIGROUPS_EXCEPTION
 
 namespace libsemigroups {
+  namespace {
+    // The first number in every file written by write_normal_forms or
+    // write_relations.
+    constexpr uint64_t WORDS_FILE_MAGIC = 0x4c535744;
+
+    void write_word(std::ofstream& os, word_type const& w) {
+      detail::write_varint(os, w.size());
+      for (auto x : w) {
+        detail::write_varint(os, x);
+      }
+    }
+
+    // Write the header of a file containing nr words to path + ".tmp",
+    // write the words using write, and then rename the file to path.
+    void write_words(std::string const&                    path,
+                     size_t                                nr,
+                     std::function<void(std::ofstream&)>&& write) {
+      std::string const tmp = path + ".tmp";
+      {
+        std::ofstream os(tmp, std::ios::binary | std::ios::trunc);
+        if (!os) {
+          LIBSEMIGROUPS_EXCEPTION("cannot open %s for writing", tmp);
+        }
+        detail::write_varint(os, WORDS_FILE_MAGIC);
+        detail::write_varint(os, nr);
+        write(os);
+        if (!os.flush()) {
+          LIBSEMIGROUPS_EXCEPTION("cannot write to %s", tmp);
+        }
+      }
+      if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+        LIBSEMIGROUPS_EXCEPTION("cannot rename %s to %s", tmp, path);
+      }
+    }
+  }  // namespace
+
   ////////////////////////////////////////////////////////////////////////
   // FroidurePinBase - settings - public
   ////////////////////////////////////////////////////////////////////////
@@ -114,4 +156,123 @@ namespace libsemigroups {
       S.next_relation(relation);
     }
   }
+
+  void for_each_relation(
+      FroidurePinBase&                                          S,
+      std::function<void(word_type const&, word_type const&)>&& hook) {
+    S.run();
+
+    std::vector<size_t> relation;  // a triple
+    S.reset_next_relation();
+    S.next_relation(relation);
+
+    word_type lhs, rhs;  // changed in-place
+    while (relation.size() == 2 && !relation.empty()) {
+      lhs.assign(1, relation[0]);
+      rhs.assign(1, relation[1]);
+      hook(lhs, rhs);
+      S.next_relation(relation);
+    }
+    while (!relation.empty()) {
+      S.factorisation(lhs, relation[0]);
+      S.factorisation(rhs, relation[2]);
+      lhs.push_back(relation[1]);
+      hook(lhs, rhs);
+      S.next_relation(relation);
+    }
+  }
+
+  void for_each_normal_form(
+      FroidurePinBase& S,
+      std::function<void(FroidurePinBase::element_index_type,
+                         word_type const&)>&& hook) {
+    size_t const n = S.size();
+    word_type    word;  // changed in-place by minimal_factorisation
+    for (FroidurePinBase::element_index_type i = 0; i < n; ++i) {
+      S.minimal_factorisation(word, i);
+      hook(i, word);
+    }
+  }
+
+  void write_normal_forms(FroidurePinBase& S, std::string const& path) {
+    size_t const n = S.size();
+    write_words(path, n, [&S](std::ofstream& os) {
+      for_each_normal_form(
+          S,
+          [&os](FroidurePinBase::element_index_type, word_type const& w) {
+            write_word(os, w);
+          });
+    });
+  }
+
+  void write_relations(FroidurePinBase& S, std::string const& path) {
+    size_t const n  = S.nr_rules();
+    size_t       nr = 0;
+    write_words(path, 2 * n, [&S, &nr](std::ofstream& os) {
+      for_each_relation(S,
+                        [&os, &nr](word_type const& lhs, word_type const& rhs) {
+                          write_word(os, lhs);
+                          write_word(os, rhs);
+                          nr++;
+                        });
+    });
+    LIBSEMIGROUPS_ASSERT(nr == n);
+  }
+
+  void read_words(std::string const&                      path,
+                  std::function<void(word_type const&)>&& hook) {
+    std::ifstream is(path, std::ios::binary);
+    if (!is) {
+      LIBSEMIGROUPS_EXCEPTION("cannot open %s for reading", path);
+    }
+    if (detail::read_varint(is) != WORDS_FILE_MAGIC) {
+      LIBSEMIGROUPS_EXCEPTION("%s was not written by write_normal_forms or "
+                              "write_relations",
+                              path);
+    }
+    uint64_t const n = detail::read_varint(is);
+    word_type      word;  // changed in-place
+    for (uint64_t i = 0; i < n; ++i) {
+      // The length is not trusted, and so the letters are appended one at a
+      // time, rather than resizing word before reading them.
+      uint64_t const k = detail::read_varint(is);
+      word.clear();
+      for (uint64_t j = 0; j < k; ++j) {
+        word.push_back(detail::read_varint(is));
+      }
+      hook(word);
+    }
+  }
+
+  ////////////////////////////////////////////////////////////////////////
+  // FroidurePinStats - public
+  ////////////////////////////////////////////////////////////////////////
+
+  void FroidurePinStats::to_json(std::ostream& os) const {
+    os << "{\"enabled\": " << (enabled ? "true" : "false")
+       << ", \"nr_products\": " << nr_products
+       << ", \"nr_products_avoided\": " << nr_products_avoided
+       << ", \"nr_hash_lookups\": " << nr_hash_lookups
+       << ", \"nr_hash_probes\": " << nr_hash_probes
+       << ", \"max_hash_probe_length\": " << max_hash_probe_length
+       << ", \"nr_hash_comparisons\": " << nr_hash_comparisons
+       << ", \"layers\": [";
+    for (auto it = layers.cbegin(); it != layers.cend(); ++it) {
+      os << (it == layers.cbegin() ? "" : ", ")
+         << "{\"length\": " << it->length
+         << ", \"nr_elements\": " << it->nr_elements
+         << ", \"nr_products\": " << it->nr_products
+         << ", \"nr_products_avoided\": " << it->nr_products_avoided
+         << ", \"nr_new\": " << it->nr_new
+         << ", \"nr_duplicates\": " << it->nr_duplicates
+         << ", \"time_ns\": " << it->time.count() << "}";
+    }
+    os << "]}";
+  }
+
+  std::string FroidurePinStats::to_json() const {
+    std::ostringstream os;
+    to_json(os);
+    return os.str();
+  }
 }  // namespace libsemigroups
@@ -0,0 +1,323 @@
+//
+// libsemigroups - C++ library for semigroups and monoids
+// Copyright (C) 2019 James D. Mitchell
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+// This file contains the implementation of the class FroidurePinView.
+
+#include "froidure-pin-view.hpp"
+
+#include <fcntl.h>     // for open, O_RDONLY
+#include <sys/mman.h>  // for mmap, munmap
+#include <sys/stat.h>  // for fstat
+#include <unistd.h>    // for close
+
+#include <cstdio>   // for rename
+#include <fstream>  // for ofstream
+#include <vector>   // for vector
+
+#include "constants.hpp"                // for UNDEFINED
+#include "libsemigroups-exception.hpp"  // for LIBSEMIGROUPS_EXCEPTION
+
+namespace libsemigroups {
+  namespace {
+    // The first 8 bytes of every file written by FroidurePinView::save.
+    constexpr uint64_t FROIDURE_PIN_VIEW_MAGIC = 0x4c534746505649;
+
+    // Every array in the file, including those containing letters and
+    // lengths, has entries of type element_index_type, so that every array
+    // is correctly aligned.
+
+    template <typename T>
+    void write_array(std::ofstream& os, std::vector<T> const& vec) {
+      os.write(reinterpret_cast<char const*>(vec.data()),
+               sizeof(T) * vec.size());
+    }
+  }  // namespace
+
+  ////////////////////////////////////////////////////////////////////////
+  // FroidurePinView - save - public
+  ////////////////////////////////////////////////////////////////////////
+
+  void FroidurePinView::save(FroidurePinBase& S, std::string const& path) {
+    size_t const n      = S.size();
+    size_t const nrgens = S.nr_generators();
+    Header const header = {FROIDURE_PIN_VIEW_MAGIC,
+                           sizeof(element_index_type),
+                           nrgens,
+                           n,
+                           S.nr_rules(),
+                           S.current_max_word_length()};
+
+    std::string const tmp = path + ".tmp";
+    {
+      std::ofstream os(tmp, std::ios::binary | std::ios::trunc);
+      if (!os) {
+        LIBSEMIGROUPS_EXCEPTION("cannot open %s for writing", tmp);
+      }
+      os.write(reinterpret_cast<char const*>(&header), sizeof(header));
+
+      std::vector<element_index_type> vec;
+      for (letter_type a = 0; a < nrgens; ++a) {
+        vec.push_back(S.letter_to_pos(a));
+      }
+      write_array(os, vec);
+      for (auto graph : {&S.right_cayley_graph(), &S.left_cayley_graph()}) {
+        vec.resize(nrgens);
+        for (element_index_type i = 0; i < n; ++i) {
+          for (letter_type a = 0; a < nrgens; ++a) {
+            vec[a] = graph->get(i, a);
+          }
+          write_array(os, vec);
+        }
+      }
+      vec.resize(n);
+      for (element_index_type i = 0; i < n; ++i) {
+        vec[i] = S.prefix(i);
+      }
+      write_array(os, vec);
+      for (element_index_type i = 0; i < n; ++i) {
+        vec[i] = S.suffix(i);
+      }
+      write_array(os, vec);
+      for (element_index_type i = 0; i < n; ++i) {
+        vec[i] = S.first_letter(i);
+      }
+      write_array(os, vec);
+      for (element_index_type i = 0; i < n; ++i) {
+        vec[i] = S.final_letter(i);
+      }
+      write_array(os, vec);
+      for (element_index_type i = 0; i < n; ++i) {
+        vec[i] = S.length_const(i);
+      }
+      write_array(os, vec);
+      if (!os.flush()) {
+        LIBSEMIGROUPS_EXCEPTION("cannot write to %s", tmp);
+      }
+    }
+    if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+      LIBSEMIGROUPS_EXCEPTION("cannot rename %s to %s", tmp, path);
+    }
+  }
+
+  ////////////////////////////////////////////////////////////////////////
+  // FroidurePinView - constructors + destructor - public
+  ////////////////////////////////////////////////////////////////////////
+
+  FroidurePinView::FroidurePinView(std::string const& path)
+      : _bytes(0), _data(nullptr) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+      LIBSEMIGROUPS_EXCEPTION("cannot open %s for reading", path);
+    }
+    struct stat st;
+    if (::fstat(fd, &st) == -1) {
+      ::close(fd);
+      LIBSEMIGROUPS_EXCEPTION("cannot determine the size of %s", path);
+    }
+    _bytes = st.st_size;
+    if (_bytes < sizeof(Header)) {
+      ::close(fd);
+      LIBSEMIGROUPS_EXCEPTION("%s is not a FroidurePinView file", path);
+    }
+    _data = ::mmap(nullptr, _bytes, PROT_READ, MAP_SHARED, fd, 0);
+    // The mapping remains valid after the file descriptor is closed.
+    ::close(fd);
+    if (_data == MAP_FAILED) {
+      LIBSEMIGROUPS_EXCEPTION("cannot map %s into memory", path);
+    }
+
+    _header = static_cast<Header const*>(_data);
+    size_t const n      = _header->_size;
+    size_t const nrgens = _header->_nr_generators;
+    if (_header->_magic != FROIDURE_PIN_VIEW_MAGIC
+        || _header->_index_size != sizeof(element_index_type)
+        || _bytes
+               != sizeof(Header)
+                      + sizeof(element_index_type)
+                            * (nrgens + 2 * n * nrgens + 5 * n)) {
+      ::munmap(_data, _bytes);
+      LIBSEMIGROUPS_EXCEPTION("%s is not a FroidurePinView file", path);
+    }
+
+    auto ptr = reinterpret_cast<char const*>(_header + 1);
+    _letter_to_pos = reinterpret_cast<element_index_type const*>(ptr);
+    ptr += sizeof(element_index_type) * nrgens;
+    _right = reinterpret_cast<element_index_type const*>(ptr);
+    ptr += sizeof(element_index_type) * n * nrgens;
+    _left = reinterpret_cast<element_index_type const*>(ptr);
+    ptr += sizeof(element_index_type) * n * nrgens;
+    _prefix = reinterpret_cast<element_index_type const*>(ptr);
+    ptr += sizeof(element_index_type) * n;
+    _suffix = reinterpret_cast<element_index_type const*>(ptr);
+    ptr += sizeof(element_index_type) * n;
+    _first = reinterpret_cast<element_index_type const*>(ptr);
+    ptr += sizeof(element_index_type) * n;
+    _final = reinterpret_cast<element_index_type const*>(ptr);
+    ptr += sizeof(element_index_type) * n;
+    _length = reinterpret_cast<element_index_type const*>(ptr);
+  }
+
+  FroidurePinView::FroidurePinView(FroidurePinView&& that) noexcept
+      : _bytes(that._bytes),
+        _data(that._data),
+        _final(that._final),
+        _first(that._first),
+        _header(that._header),
+        _left(that._left),
+        _length(that._length),
+        _letter_to_pos(that._letter_to_pos),
+        _prefix(that._prefix),
+        _right(that._right),
+        _suffix(that._suffix) {
+    that._data = nullptr;
+  }
+
+  FroidurePinView::~FroidurePinView() {
+    if (_data != nullptr) {
+      ::munmap(_data, _bytes);
+    }
+  }
+
+  ////////////////////////////////////////////////////////////////////////
+  // FroidurePinView - member functions - public
+  ////////////////////////////////////////////////////////////////////////
+
+  FroidurePinView::element_index_type
+  FroidurePinView::letter_to_pos(letter_type a) const {
+    validate_letter_index(a);
+    return _letter_to_pos[a];
+  }
+
+  FroidurePinView::element_index_type
+  FroidurePinView::right(element_index_type i, letter_type a) const {
+    validate_element_index(i);
+    validate_letter_index(a);
+    return _right[i * nr_generators() + a];
+  }
+
+  FroidurePinView::element_index_type
+  FroidurePinView::left(element_index_type i, letter_type a) const {
+    validate_element_index(i);
+    validate_letter_index(a);
+    return _left[i * nr_generators() + a];
+  }
+
+  FroidurePinView::element_index_type
+  FroidurePinView::prefix(element_index_type i) const {
+    validate_element_index(i);
+    return _prefix[i];
+  }
+
+  FroidurePinView::element_index_type
+  FroidurePinView::suffix(element_index_type i) const {
+    validate_element_index(i);
+    return _suffix[i];
+  }
+
+  letter_type FroidurePinView::first_letter(element_index_type i) const {
+    validate_element_index(i);
+    return _first[i];
+  }
+
+  letter_type FroidurePinView::final_letter(element_index_type i) const {
+    validate_element_index(i);
+    return _final[i];
+  }
+
+  size_t FroidurePinView::length(element_index_type i) const {
+    validate_element_index(i);
+    return _length[i];
+  }
+
+  FroidurePinView::element_index_type
+  FroidurePinView::word_to_pos(word_type const& w) const {
+    if (w.size() == 0) {
+      LIBSEMIGROUPS_EXCEPTION("the given word has length 0");
+    }
+    for (auto x : w) {
+      validate_letter_index(x);
+    }
+    size_t const       nrgens = nr_generators();
+    element_index_type out    = _letter_to_pos[w[0]];
+    for (auto it = w.cbegin() + 1; it < w.cend(); ++it) {
+      out = _right[out * nrgens + *it];
+    }
+    return out;
+  }
+
+  FroidurePinView::element_index_type
+  FroidurePinView::product_by_reduction(element_index_type i,
+                                        element_index_type j) const {
+    validate_element_index(i);
+    validate_element_index(j);
+    size_t const nrgens = nr_generators();
+
+    if (_length[i] <= _length[j]) {
+      while (i != UNDEFINED) {
+        j = _left[j * nrgens + _final[i]];
+        i = _prefix[i];
+      }
+      return j;
+    } else {
+      while (j != UNDEFINED) {
+        i = _right[i * nrgens + _first[j]];
+        j = _suffix[j];
+      }
+      return i;
+    }
+  }
+
+  void FroidurePinView::minimal_factorisation(word_type&         word,
+                                              element_index_type pos) const {
+    validate_element_index(pos);
+    word.clear();
+    while (pos != UNDEFINED) {
+      word.push_back(_first[pos]);
+      pos = _suffix[pos];
+    }
+  }
+
+  word_type
+  FroidurePinView::minimal_factorisation(element_index_type pos) const {
+    word_type word;
+    minimal_factorisation(word, pos);
+    return word;
+  }
+
+  ////////////////////////////////////////////////////////////////////////
+  // FroidurePinView - validation member functions - private
+  ////////////////////////////////////////////////////////////////////////
+
+  void FroidurePinView::validate_element_index(element_index_type i) const {
+    if (i >= size()) {
+      LIBSEMIGROUPS_EXCEPTION(
+          "element index out of bounds, expected value in [0, %d), got %d",
+          size(),
+          i);
+    }
+  }
+
+  void FroidurePinView::validate_letter_index(letter_type i) const {
+    if (i >= nr_generators()) {
+      LIBSEMIGROUPS_EXCEPTION(
+          "generator index out of bounds, expected value in [0, %d), got %d",
+          nr_generators(),
+          i);
+    }
+  }
+}  // namespace libsemigroups
@@ -0,0 +1,69 @@
+//
+// libsemigroups - C++ library for semigroups and monoids
+// Copyright (C) 2019 James D. Mitchell
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+// This file contains the implementation of the functions used by the class
+// detail::MmapAllocator.
+
+#include "mmap-allocator.hpp"
+
+#include <stdlib.h>    // for mkstemp
+#include <sys/mman.h>  // for mmap, munmap
+#include <unistd.h>    // for close, ftruncate, unlink
+
+#include <vector>  // for vector
+
+#include "libsemigroups-exception.hpp"  // for LIBSEMIGROUPS_EXCEPTION
+
+namespace libsemigroups {
+  namespace detail {
+    void* mmap_allocate(std::string const& dir, size_t nr_bytes) {
+      if (nr_bytes == 0) {
+        return nullptr;
+      }
+      std::string const name = dir + "/libsemigroups-XXXXXX";
+      std::vector<char> path(name.cbegin(), name.cend());
+      path.push_back('\0');
+      int const fd = ::mkstemp(path.data());
+      if (fd == -1) {
+        LIBSEMIGROUPS_EXCEPTION("cannot create a file in %s", dir);
+      }
+      // The mapping keeps the contents of the file, and so the file can be
+      // removed (and the file descriptor closed) immediately.
+      ::unlink(path.data());
+      if (::ftruncate(fd, nr_bytes) == -1) {
+        ::close(fd);
+        LIBSEMIGROUPS_EXCEPTION("cannot extend a file in %s to %d bytes",
+                                dir,
+                                nr_bytes);
+      }
+      void* data
+          = ::mmap(nullptr, nr_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      ::close(fd);
+      if (data == MAP_FAILED) {
+        LIBSEMIGROUPS_EXCEPTION("cannot map a file in %s into memory", dir);
+      }
+      return data;
+    }
+
+    void mmap_deallocate(void* ptr, size_t nr_bytes) noexcept {
+      if (ptr != nullptr) {
+        ::munmap(ptr, nr_bytes);
+      }
+    }
+  }  // namespace detail
+}  // namespace libsemigroups
@@ -0,0 +1,83 @@
+//
+// libsemigroups - C++ library for semigroups and monoids
+// Copyright (C) 2019 James D. Mitchell
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+// This file contains the implementation of the class detail::SpillFile.
+
+#include "spill-file.hpp"
+
+#include <errno.h>     // for errno, EINTR
+#include <fcntl.h>     // for open, O_RDWR, O_CREAT, O_TRUNC
+#include <sys/mman.h>  // for mmap, munmap
+#include <unistd.h>    // for close, unlink, write
+
+#include "libsemigroups-exception.hpp"  // for LIBSEMIGROUPS_EXCEPTION
+
+namespace libsemigroups {
+  namespace detail {
+    SpillFile::SpillFile(std::string const& path)
+        : _data(nullptr), _fd(-1), _mapped(0), _path(path), _size(0) {
+      _fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+      if (_fd == -1) {
+        LIBSEMIGROUPS_EXCEPTION("cannot open %s for writing", path);
+      }
+    }
+
+    SpillFile::~SpillFile() {
+      unmap();
+      ::close(_fd);
+      ::unlink(_path.c_str());
+    }
+
+    void SpillFile::write(void const* ptr, size_t nr) {
+      char const* next = static_cast<char const*>(ptr);
+      while (nr != 0) {
+        ssize_t const n = ::write(_fd, next, nr);
+        if (n == -1) {
+          if (errno == EINTR) {
+            continue;
+          }
+          LIBSEMIGROUPS_EXCEPTION("cannot write to %s", _path);
+        }
+        next += n;
+        nr -= n;
+        _size += n;
+      }
+    }
+
+    void SpillFile::map() {
+      unmap();
+      if (_size == 0) {
+        return;
+      }
+      void* data = ::mmap(nullptr, _size, PROT_READ, MAP_SHARED, _fd, 0);
+      if (data == MAP_FAILED) {
+        LIBSEMIGROUPS_EXCEPTION("cannot map %s into memory", _path);
+      }
+      _data   = static_cast<char*>(data);
+      _mapped = _size;
+    }
+
+    void SpillFile::unmap() noexcept {
+      if (_data != nullptr) {
+        ::munmap(_data, _mapped);
+        _data   = nullptr;
+        _mapped = 0;
+      }
+    }
+  }  // namespace detail
+}  // namespace libsemigroups
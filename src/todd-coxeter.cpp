@@ -22,18 +22,24 @@
 #include "todd-coxeter.hpp"
 
 #include <algorithm>  // for reverse
+#include <array>      // for array
 #include <chrono>     // for nanoseconds etc
 #include <cstddef>    // for size_t
+#include <cstdint>    // for uint64_t
+#include <cstdio>     // for rename
+#include <fstream>    // for ifstream, ofstream
 #include <memory>     // for shared_ptr
 #include <numeric>    // for iota
 #include <random>     // for mt19937
 #include <string>     // for operator+, basic_string
+#include <thread>     // for thread
 #include <utility>    // for pair
 
 #ifdef LIBSEMIGROUPS_DEBUG
 #include <set>  // for set
 #endif
 
+#include "binary-io.hpp"                // for read_binary, write_binary
 #include "cong-intf.hpp"                // for CongruenceInterface
 #include "coset.hpp"                    // for CosetManager
 #include "froidure-pin-base.hpp"        // for FroidurePinBase
@@ -43,6 +49,7 @@
 #include "libsemigroups-debug.hpp"      // for LIBSEMIGROUPS_ASSERT
 #include "libsemigroups-exception.hpp"  // for LIBSEMIGROUPS_EXCEPTION
 #include "obvinf.hpp"                   // for IsObviouslyInfinite
+#include "race.hpp"                     // for Race
 #include "report.hpp"                   // for REPORT
 #include "stl.hpp"                      // for apply_permutation
 #include "tce.hpp"                      // for TCE
@@ -55,23 +62,11 @@
 //    just means making sure that there are no undefined values in the row of
 //    the current coset, this is an option from ACE.
 //
-// 2. Allow there to be a limit to the number of deductions that are stacked.
-//    this is an option from ACE. There are 4 options as described:
+// 2. Explore whether deductions can be useful in HLT.
 //
-//    https://magma.maths.usyd.edu.au/magma/handbook/text/833
+// 3. Wreath product standardize mem fn.
 //
-// 3. Explore whether deductions can be useful in HLT.
-//
-// 4. Make make_deductions_dfs non-recursive, this will likely only be an issue
-//    for presentations with extremely long relations.
-//
-// 5. Use path compression in _ident, or other techniques from union-find, see:
-//
-//      https://www.boost.org/doc/libs/1_70_0/boost/pending/disjoint_sets.hpp
-//
-// 6. Wreath product standardize mem fn.
-//
-// 7. ACE stacks deductions when processing coincidences, we don't
+// 4. ACE stacks deductions when processing coincidences, we don't
 
 ////////////////////////////////////////////////////////////////////////////////
 // COSET TABLES:
@@ -179,20 +174,27 @@ namespace libsemigroups {
     using Coincidence = std::pair<coset_type, coset_type>;
     using Deduction   = std::pair<coset_type, letter_type>;
 
+    ////////////////////////////////////////////////////////////////////////
+    // Constants
+    ////////////////////////////////////////////////////////////////////////
+
+    // The first 8 bytes of every file written by ToddCoxeter::save_checkpoint.
+    constexpr uint64_t TODD_COXETER_CHECKPOINT_MAGIC = 0x4c5347544343504b;
+
     ////////////////////////////////////////////////////////////////////////
     // Helper structs
     ////////////////////////////////////////////////////////////////////////
 
     struct StackDeductions {
-      inline void operator()(std::stack<Deduction>& stck,
-                             coset_type             c,
-                             letter_type            a) const noexcept {
-        stck.emplace(c, a);
+      inline void operator()(std::vector<Deduction>& stck,
+                             coset_type              c,
+                             letter_type             a) const noexcept {
+        stck.emplace_back(c, a);
       }
     };
 
     struct DoNotStackDeductions {
-      inline void operator()(std::stack<Deduction>&,
+      inline void operator()(std::vector<Deduction>&,
                              coset_type,
                              letter_type) const noexcept {}
     };
@@ -227,14 +229,19 @@ namespace libsemigroups {
 #ifdef LIBSEMIGROUPS_DEBUG
             enable_debug_verify_no_missing_deductions(true),
 #endif
+            compaction_ratio(0.25),
+            deductions(policy::deductions::unlimited),
             lookahead(policy::lookahead::partial),
             lower_bound(UNDEFINED),
+            max_deductions(100000),
+            max_threads(std::max(1u, std::thread::hardware_concurrency())),
             next_lookahead(5000000),
             froidure_pin(policy::froidure_pin::none),
             random_interval(200000000),
             save(false),
             standardize(false),
-            strategy(policy::strategy::hlt) {
+            strategy(policy::strategy::hlt),
+            table_directory() {
       }
 
       Settings(Settings const& copy) = default;
@@ -242,14 +249,19 @@ namespace libsemigroups {
 #ifdef LIBSEMIGROUPS_DEBUG
       bool enable_debug_verify_no_missing_deductions;
 #endif
+      float                    compaction_ratio;
+      policy::deductions       deductions;
       policy::lookahead        lookahead;
       size_t                   lower_bound;
+      size_t                   max_deductions;
+      size_t                   max_threads;
       size_t                   next_lookahead;
       policy::froidure_pin     froidure_pin;
       std::chrono::nanoseconds random_interval;
       bool                     save;
       bool                     standardize;
       policy::strategy         strategy;
+      std::string              table_directory;
     };
 
     class ToddCoxeter::FelschTree {
@@ -367,11 +379,16 @@ namespace libsemigroups {
     ToddCoxeter::ToddCoxeter(congruence_type type)
         : CongruenceInterface(type),
           CosetManager(),
+          _checkpoint(),
           _coinc(),
           _deduct(),
+          _deductions_discarded(false),
+          _dfs(),
           _extra(),
           _felsch_tree(nullptr),
+          _nr_killed_at_compaction(0),
           _nr_pairs_added_earlier(0),
+          _portfolio(nullptr),
           _prefilled(false),
           _preim_init(0, 0, UNDEFINED),
           _preim_next(0, 0, UNDEFINED),
@@ -379,17 +396,23 @@ namespace libsemigroups {
           _settings(new Settings()),
           _standardized(order::none),
           _state(state::constructed),
+          _switched_to_hlt(false),
           _table(0, 0, UNDEFINED),
           _tree(nullptr) {}
 
     ToddCoxeter::ToddCoxeter(ToddCoxeter const& copy)
         : CongruenceInterface(copy),
           CosetManager(copy),
+          _checkpoint(),
           _coinc(copy._coinc),
           _deduct(copy._deduct),
+          _deductions_discarded(copy._deductions_discarded),
+          _dfs(),
           _extra(copy._extra),
           _felsch_tree(nullptr),
+          _nr_killed_at_compaction(copy._nr_killed_at_compaction),
           _nr_pairs_added_earlier(copy._nr_pairs_added_earlier),
+          _portfolio(nullptr),
           _prefilled(copy._prefilled),
           _preim_init(copy._preim_init),
           _preim_next(copy._preim_next),
@@ -397,6 +420,7 @@ namespace libsemigroups {
           _settings(detail::make_unique<Settings>(*copy._settings)),
           _standardized(copy._standardized),
           _state(copy._state),
+          _switched_to_hlt(copy._switched_to_hlt),
           _table(copy._table),
           _tree(nullptr) {
       if (copy._felsch_tree != nullptr) {
@@ -500,11 +524,70 @@ namespace libsemigroups {
       return _settings->froidure_pin;
     }
 
+    ToddCoxeter& ToddCoxeter::deduction_policy(policy::deductions x) noexcept {
+      _settings->deductions = x;
+      return *this;
+    }
+
+    ToddCoxeter::policy::deductions ToddCoxeter::deduction_policy() const
+        noexcept {
+      return _settings->deductions;
+    }
+
+    ToddCoxeter& ToddCoxeter::max_deductions(size_t n) noexcept {
+      _settings->max_deductions = n;
+      return *this;
+    }
+
+    size_t ToddCoxeter::max_deductions() const noexcept {
+      return _settings->max_deductions;
+    }
+
     ToddCoxeter& ToddCoxeter::lookahead(policy::lookahead x) noexcept {
       _settings->lookahead = x;
       return *this;
     }
 
+    ToddCoxeter& ToddCoxeter::max_threads(size_t n) noexcept {
+      unsigned int const m = std::thread::hardware_concurrency();
+      _settings->max_threads
+          = std::max(size_t(1), (m == 0 ? n : std::min(n, size_t(m))));
+      return *this;
+    }
+
+    size_t ToddCoxeter::max_threads() const noexcept {
+      return _settings->max_threads;
+    }
+
+    ToddCoxeter& ToddCoxeter::compaction_ratio(float x) noexcept {
+      _settings->compaction_ratio = x;
+      return *this;
+    }
+
+    float ToddCoxeter::compaction_ratio() const noexcept {
+      return _settings->compaction_ratio;
+    }
+
+    ToddCoxeter& ToddCoxeter::table_directory(std::string const& dir) {
+      if (dir != _settings->table_directory) {
+        detail::MmapAllocator<coset_type> alloc(dir);
+        // The copies are made before anything is modified, in case one of
+        // them throws.
+        InternalTable table(_table, alloc);
+        InternalTable preim_init(_preim_init, alloc);
+        InternalTable preim_next(_preim_next, alloc);
+        _table.swap(table);
+        _preim_init.swap(preim_init);
+        _preim_next.swap(preim_next);
+        _settings->table_directory = dir;
+      }
+      return *this;
+    }
+
+    std::string const& ToddCoxeter::table_directory() const noexcept {
+      return _settings->table_directory;
+    }
+
     ToddCoxeter& ToddCoxeter::lower_bound(size_t n) noexcept {
       _settings->lower_bound = n;
       return *this;
@@ -547,6 +630,7 @@ namespace libsemigroups {
                                 "prefilled ToddCoxeter instance");
       }
       _settings->strategy = x;
+      _switched_to_hlt    = false;
       return *this;
     }
 
@@ -611,7 +695,9 @@ namespace libsemigroups {
         return;
       }
       if (!is_standardized()) {
-        standardize(order::shortlex);
+        // Only the active cosets being in [0, nr_cosets_active()) is required
+        // here, and so there is no need to standardize.
+        compact();
       }
 
       _table.shrink_rows_to(nr_cosets_active());
@@ -626,6 +712,305 @@ namespace libsemigroups {
       erase_free_cosets();
     }
 
+    ////////////////////////////////////////////////////////////////////////
+    // ToddCoxeter - member functions (checkpointing) - public
+    ////////////////////////////////////////////////////////////////////////
+
+    void ToddCoxeter::save_checkpoint(std::string const& path) const {
+      std::string const tmp = path + ".tmp";
+      {
+        std::ofstream os(tmp, std::ios::binary | std::ios::trunc);
+        if (!os) {
+          LIBSEMIGROUPS_EXCEPTION("cannot open %s for writing", tmp);
+        }
+        uint64_t const         magic      = TODD_COXETER_CHECKPOINT_MAGIC;
+        uint64_t const         index_size = sizeof(coset_type);
+        size_t const           nrgens     = nr_generators();
+        std::vector<word_type> pairs;
+        for (auto it = cbegin_generating_pairs(); it < cend_generating_pairs();
+             ++it) {
+          pairs.push_back(it->first);
+          pairs.push_back(it->second);
+        }
+        // The stack of coincidences is written from the bottom to the top.
+        std::vector<Coincidence> coinc;
+        auto                     stck = _coinc;
+        while (!stck.empty()) {
+          coinc.push_back(stck.top());
+          stck.pop();
+        }
+        std::reverse(coinc.begin(), coinc.end());
+
+        detail::write_binary(os, magic);
+        detail::write_binary(os, index_size);
+        detail::write_binary(os, kind());
+        detail::write_binary(os, nrgens);
+        detail::write_binary(os, pairs);
+        detail::write_binary(os, _relations);
+        detail::write_binary(os, _extra);
+        detail::write_binary(os, _settings->compaction_ratio);
+        detail::write_binary(os, _settings->deductions);
+        detail::write_binary(os, _settings->lookahead);
+        detail::write_binary(os, _settings->lower_bound);
+        detail::write_binary(os, _settings->max_deductions);
+        detail::write_binary(os, _settings->max_threads);
+        detail::write_binary(os, _settings->next_lookahead);
+        detail::write_binary(os, _settings->froidure_pin);
+        detail::write_binary(os, _settings->random_interval.count());
+        detail::write_binary(os, _settings->save);
+        detail::write_binary(os, _settings->standardize);
+        detail::write_binary(os, _settings->strategy);
+        detail::write_binary(os, _state);
+        detail::write_binary(os, _prefilled);
+        detail::write_binary(os, _nr_pairs_added_earlier);
+        detail::write_binary(os, _nr_killed_at_compaction);
+        detail::write_binary(os, _deductions_discarded);
+        detail::write_binary(os, _switched_to_hlt);
+        detail::write_binary(os, coinc);
+        detail::write_binary(os, _deduct);
+        detail::write_binary(os, _table);
+        detail::write_binary(os, _preim_init);
+        detail::write_binary(os, _preim_next);
+        write_cosets(os);
+        if (!os.flush()) {
+          LIBSEMIGROUPS_EXCEPTION("cannot write to %s", tmp);
+        }
+      }
+      detail::write_checksum(tmp);
+      if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+        LIBSEMIGROUPS_EXCEPTION("cannot rename %s to %s", tmp, path);
+      }
+    }
+
+    void ToddCoxeter::load_checkpoint(std::string const& path) {
+      if (started()) {
+        LIBSEMIGROUPS_EXCEPTION(
+            "cannot load a checkpoint after the enumeration has started");
+      }
+      std::ifstream is(path, std::ios::binary);
+      if (!is) {
+        LIBSEMIGROUPS_EXCEPTION("cannot open %s for reading", path);
+      } else if (!detail::valid_checksum(is)) {
+        LIBSEMIGROUPS_EXCEPTION("%s is not a ToddCoxeter checkpoint", path);
+      }
+
+      uint64_t magic, index_size;
+      detail::read_binary(is, magic);
+      detail::read_binary(is, index_size);
+      if (magic != TODD_COXETER_CHECKPOINT_MAGIC
+          || index_size != sizeof(coset_type)) {
+        LIBSEMIGROUPS_EXCEPTION("%s is not a ToddCoxeter checkpoint", path);
+      }
+
+      congruence_type        knd;
+      size_t                 nrgens;
+      std::vector<word_type> pairs;
+      detail::read_binary(is, knd);
+      detail::read_binary(is, nrgens);
+      detail::read_binary(is, pairs);
+      if (knd != kind()) {
+        LIBSEMIGROUPS_EXCEPTION("the kind of congruence in %s is not the same "
+                                "as that of this",
+                                path);
+      } else if (nrgens != nr_generators()) {
+        LIBSEMIGROUPS_EXCEPTION("expected %d generators, found %d in %s",
+                                nr_generators(),
+                                nrgens,
+                                path);
+      } else if (pairs.size() != 2 * nr_generating_pairs()) {
+        LIBSEMIGROUPS_EXCEPTION(
+            "the generating pairs are not the same as in %s", path);
+      }
+      auto it = cbegin_generating_pairs();
+      for (size_t i = 0; i < pairs.size(); i += 2, ++it) {
+        if (it->first != pairs[i] || it->second != pairs[i + 1]) {
+          LIBSEMIGROUPS_EXCEPTION(
+              "the generating pairs are not the same as in %s", path);
+        }
+      }
+
+      std::chrono::nanoseconds::rep random_interval;
+      std::vector<word_type>        relations, extra;
+      Settings                      settings(*_settings);
+      state                         st;
+      bool                          prefilled, deductions_discarded;
+      bool                          switched_to_hlt;
+      size_t                        nr_pairs_added_earlier;
+      size_t                        nr_killed_at_compaction;
+      std::vector<Coincidence>      coinc;
+      std::vector<Deduction>        deduct;
+
+      size_t const  m = _table.nr_cols();
+      InternalTable table(m, 0, UNDEFINED, _table.get_allocator());
+      InternalTable preim_init(m, 0, UNDEFINED, _table.get_allocator());
+      InternalTable preim_next(m, 0, UNDEFINED, _table.get_allocator());
+
+      detail::read_binary(is, relations);
+      detail::read_binary(is, extra);
+      detail::read_binary(is, settings.compaction_ratio);
+      detail::read_binary(is, settings.deductions);
+      detail::read_binary(is, settings.lookahead);
+      detail::read_binary(is, settings.lower_bound);
+      detail::read_binary(is, settings.max_deductions);
+      detail::read_binary(is, settings.max_threads);
+      detail::read_binary(is, settings.next_lookahead);
+      detail::read_binary(is, settings.froidure_pin);
+      detail::read_binary(is, random_interval);
+      detail::read_binary(is, settings.save);
+      detail::read_binary(is, settings.standardize);
+      detail::read_binary(is, settings.strategy);
+      detail::read_binary(is, st);
+      detail::read_binary(is, prefilled);
+      detail::read_binary(is, nr_pairs_added_earlier);
+      detail::read_binary(is, nr_killed_at_compaction);
+      detail::read_binary(is, deductions_discarded);
+      detail::read_binary(is, switched_to_hlt);
+      detail::read_binary(is, coinc);
+      detail::read_binary(is, deduct);
+      detail::read_binary(is, table);
+      detail::read_binary(is, preim_init);
+      detail::read_binary(is, preim_next);
+      if (table.nr_rows() != preim_init.nr_rows()
+          || table.nr_rows() != preim_next.nr_rows()
+          || st > state::finished) {
+        LIBSEMIGROUPS_EXCEPTION("%s is not a ToddCoxeter checkpoint", path);
+      }
+      // Every value used as a coset or a letter below must be in range, or
+      // else the next call to run could read out of bounds.
+      size_t const n           = table.nr_rows();
+      auto         valid_coset = [&n](coset_type c) -> bool {
+        return c < n || c == UNDEFINED;
+      };
+      auto valid_table = [&valid_coset](InternalTable const& tab) -> bool {
+        for (size_t c = 0; c < tab.nr_rows(); ++c) {
+          for (size_t x = 0; x < tab.nr_cols(); ++x) {
+            if (!valid_coset(tab.get(c, x))) {
+              return false;
+            }
+          }
+        }
+        return true;
+      };
+      auto valid_words = [this](std::vector<word_type> const& words) -> bool {
+        if (words.size() % 2 != 0) {
+          return false;
+        }
+        for (auto const& w : words) {
+          if (w.empty()) {
+            return false;
+          }
+          for (letter_type x : w) {
+            if (x >= nr_generators()) {
+              return false;
+            }
+          }
+        }
+        return true;
+      };
+      if (!valid_table(table) || !valid_table(preim_init)
+          || !valid_table(preim_next) || !valid_words(relations)
+          || !valid_words(extra)) {
+        LIBSEMIGROUPS_EXCEPTION("%s is not a ToddCoxeter checkpoint", path);
+      }
+      for (auto const& c : coinc) {
+        if (c.first >= n || c.second >= n) {
+          LIBSEMIGROUPS_EXCEPTION("%s is not a ToddCoxeter checkpoint", path);
+        }
+      }
+      for (auto const& d : deduct) {
+        if (d.first >= n || d.second >= nr_generators()) {
+          LIBSEMIGROUPS_EXCEPTION("%s is not a ToddCoxeter checkpoint", path);
+        }
+      }
+      // The table is prefilled when this is initialized, if this was
+      // constructed from a FroidurePin whose Cayley graph is used, or by
+      // calling prefill, and the file must agree with this.
+      if (prefilled != _prefilled) {
+        policy::froidure_pin const fp = settings.froidure_pin;
+        if (!prefilled || st == state::constructed || !has_parent_froidure_pin()
+            || (fp != policy::froidure_pin::use_cayley_graph
+                && fp != policy::froidure_pin::none)
+            || parent_froidure_pin()->is_finite() != tril::TRUE) {
+          LIBSEMIGROUPS_EXCEPTION("%s is not a ToddCoxeter checkpoint", path);
+        }
+      }
+      settings.random_interval = std::chrono::nanoseconds(random_interval);
+
+      // read_cosets does not modify this if it throws. The remaining checks
+      // require the active cosets, and so are made after it, and the
+      // original cosets are restored if they fail. Nothing after them can
+      // throw.
+      detail::CosetManager old(*this);
+      read_cosets(is, n);
+      // The values in the rows of active cosets must be active cosets or
+      // UNDEFINED, and the lists of preimages must contain exactly the
+      // active cosets whose image is defined.
+      auto valid_preimages = [&]() -> bool {
+        std::vector<bool> seen;
+        for (letter_type x = 0; x < nr_generators(); ++x) {
+          seen.assign(n, false);
+          size_t nr_defined = 0, nr_listed = 0;
+          for (coset_type c = _id_coset; c != first_free_coset();
+               c            = next_active_coset(c)) {
+            coset_type const e = table.get(c, x);
+            if (e != UNDEFINED && !is_active_coset(e)) {
+              return false;
+            }
+            nr_defined += (e != UNDEFINED);
+            for (coset_type d = preim_init.get(c, x); d != UNDEFINED;
+                 d            = preim_next.get(d, x)) {
+              if (seen[d] || !is_active_coset(d) || table.get(d, x) != c) {
+                return false;
+              }
+              seen[d] = true;
+              nr_listed++;
+            }
+          }
+          if (nr_defined != nr_listed) {
+            return false;
+          }
+        }
+        return true;
+      };
+      if (!valid_preimages()) {
+        swap_cosets(old);
+        LIBSEMIGROUPS_EXCEPTION("%s is not a ToddCoxeter checkpoint", path);
+      }
+
+      _relations               = std::move(relations);
+      _extra                   = std::move(extra);
+      *_settings               = settings;
+      _state                   = st;
+      _prefilled               = prefilled;
+      _nr_pairs_added_earlier  = nr_pairs_added_earlier;
+      _nr_killed_at_compaction = nr_killed_at_compaction;
+      _deductions_discarded    = deductions_discarded;
+      _switched_to_hlt         = switched_to_hlt;
+      _coinc                   = std::stack<Coincidence>();
+      for (auto const& c : coinc) {
+        _coinc.push(c);
+      }
+      _deduct = std::move(deduct);
+      _table.swap(table);
+      _preim_init.swap(preim_init);
+      _preim_next.swap(preim_next);
+      _dfs.clear();
+      _felsch_tree.reset();
+      _tree.reset();
+      _standardized = order::none;
+      // The file might have been written on a machine with more cores.
+      max_threads(_settings->max_threads);
+    }
+
+    ToddCoxeter& ToddCoxeter::checkpoint(std::string const& path) {
+      _checkpoint = path;
+      return *this;
+    }
+
+    std::string const& ToddCoxeter::checkpoint() const noexcept {
+      return _checkpoint;
+    }
+
     ////////////////////////////////////////////////////////////////////////
     // ToddCoxeter - member functions (state) - public
     ////////////////////////////////////////////////////////////////////////
@@ -753,12 +1138,18 @@ namespace libsemigroups {
         run_until([this, &bound]() -> bool {
           return (nr_cosets_active() == bound) && complete();
         });
-      } else if (_settings->strategy == policy::strategy::felsch) {
+      } else if (_settings->strategy == policy::strategy::felsch
+                 && !_switched_to_hlt) {
         felsch();
-      } else if (_settings->strategy == policy::strategy::hlt) {
+      } else if (_settings->strategy == policy::strategy::hlt
+                 || _settings->strategy == policy::strategy::felsch) {
+        // If the strategy is Felsch here, then the deduction policy is
+        // switch_to_hlt and the deduction stack overflowed.
         hlt();
       } else if (_settings->strategy == policy::strategy::random) {
         sims();
+      } else if (_settings->strategy == policy::strategy::portfolio) {
+        portfolio();
       }
     }
 
@@ -825,16 +1216,17 @@ namespace libsemigroups {
 
     void ToddCoxeter::set_nr_generators_impl(size_t n) {
       // TODO(later) add columns to make it up to n?
-      _preim_init = Table(n, 1, UNDEFINED);
-      _preim_next = Table(n, 1, UNDEFINED);
-      _table      = Table(n, 1, UNDEFINED);
+      _preim_init = InternalTable(n, 1, UNDEFINED, _table.get_allocator());
+      _preim_next = InternalTable(n, 1, UNDEFINED, _table.get_allocator());
+      _table      = InternalTable(n, 1, UNDEFINED, _table.get_allocator());
     }
 
     ////////////////////////////////////////////////////////////////////////
     // ToddCoxeter - member functions (validation) - private
     ////////////////////////////////////////////////////////////////////////
 
-    void ToddCoxeter::validate_table(Table const& table,
+    template <typename T>
+    void ToddCoxeter::validate_table(T const&     table,
                                      size_t const first,
                                      size_t const last) const {
       REPORT_DEBUG_DEFAULT("validating coset table...\n");
@@ -1065,22 +1457,45 @@ namespace libsemigroups {
       }
     }
 
-    // Perform a DFS in _felsch_tree
+    // Perform a DFS in _felsch_tree, using the explicit stack _dfs rather
+    // than recursion, since the depth of the DFS is the length of the
+    // longest relation.
     void ToddCoxeter::make_deductions_dfs(coset_type const c) {
-      for (auto it = _felsch_tree->cbegin(); it < _felsch_tree->cend(); ++it) {
-        push_definition_felsch<StackDeductions, DoNotProcessCoincidences>(
-            c, _relations[*it], _relations[*it + 1]);
-      }
-
+      LIBSEMIGROUPS_ASSERT(_dfs.empty());
       size_t const n = nr_generators();
-      for (size_t x = 0; x < n; ++x) {
-        if (_felsch_tree->push_front(x)) {
-          coset_type e = _preim_init.get(c, x);
-          while (e != UNDEFINED) {
-            make_deductions_dfs(e);
-            e = _preim_next.get(e, x);
+      coset_type   e = c;
+      while (true) {
+        // Push e through every relation corresponding to the current state
+        for (auto it = _felsch_tree->cbegin(); it < _felsch_tree->cend();
+             ++it) {
+          push_definition_felsch<StackDeductions, DoNotProcessCoincidences>(
+              e, _relations[*it], _relations[*it + 1]);
+        }
+        _dfs.emplace_back(e, 0, UNDEFINED);
+        // Find the next preimage to visit
+        e = UNDEFINED;
+        while (!_dfs.empty()) {
+          DFSFrame& f = _dfs.back();
+          if (f.preim != UNDEFINED) {
+            f.preim = _preim_next.get(f.preim, f.gen);
+          } else if (f.gen == n) {
+            _dfs.pop_back();
+            continue;
+          } else if (_felsch_tree->push_front(f.gen)) {
+            f.preim = _preim_init.get(f.coset, f.gen);
+          } else {
+            ++f.gen;
+            continue;
+          }
+          if (f.preim != UNDEFINED) {
+            e = f.preim;
+            break;
           }
           _felsch_tree->pop_front();
+          ++f.gen;
+        }
+        if (e == UNDEFINED) {
+          return;
         }
       }
     }
@@ -1093,19 +1508,67 @@ namespace libsemigroups {
                                _deduct.size());
       }
 #endif
-      while (!_deduct.empty()) {
-        auto d = _deduct.top();
-        _deduct.pop();
-        if (is_active_coset(d.first)) {
-          _felsch_tree->push_back(d.second);
-          make_deductions_dfs(d.first);
-          process_coincidences<StackDeductions>();
+      bool const limited
+          = _settings->deductions != policy::deductions::unlimited;
+      do {
+        while (!_deduct.empty()) {
+          auto d = _deduct.back();
+          _deduct.pop_back();
+          if (is_active_coset(d.first)) {
+            _felsch_tree->push_back(d.second);
+            make_deductions_dfs(d.first);
+            process_coincidences<StackDeductions>();
+            if (limited && _deduct.size() > _settings->max_deductions) {
+              limit_deductions();
+            }
+          }
+        }
+        process_coincidences<StackDeductions>();
+      } while (!_deduct.empty());
+    }
+
+    // Apply the deduction policy, this is ACE's "dmode".
+    void ToddCoxeter::limit_deductions() {
+      REPORT_DEBUG_DEFAULT("the deduction stack is full (%llu deductions)\n",
+                           _deduct.size());
+      switch (_settings->deductions) {
+        case policy::deductions::purge_from_top:
+        case policy::deductions::purge_all: {
+          _deduct.erase(std::remove_if(_deduct.begin(),
+                                       _deduct.end(),
+                                       [this](Deduction const& d) -> bool {
+                                         return !is_active_coset(d.first);
+                                       }),
+                        _deduct.end());
+          if (_deduct.size() <= _settings->max_deductions) {
+            return;
+          } else if (_settings->deductions
+                     == policy::deductions::purge_from_top) {
+            _deduct.resize(_settings->max_deductions);
+          } else {
+            _deduct.clear();
+          }
+          break;
+        }
+        case policy::deductions::discard_all_if_no_space: {
+          _deduct.clear();
+          break;
+        }
+        case policy::deductions::switch_to_hlt: {
+          _deduct.clear();
+          if (_state != state::hlt) {
+            // felsch checks _switched_to_hlt after every call to
+            // process_deductions, and switches to HLT if it is true.
+            _switched_to_hlt = true;
+          }
+          break;
+        }
+        case policy::deductions::unlimited: {
+          LIBSEMIGROUPS_ASSERT(false);
+          return;
         }
       }
-      process_coincidences<StackDeductions>();
-      if (!_deduct.empty()) {
-        process_deductions();
-      }
+      _deductions_discarded = true;
     }
 
     ////////////////////////////////////////////////////////////////////////
@@ -1143,15 +1606,21 @@ namespace libsemigroups {
         }
       } else if (_state == state::hlt) {
         _current = _id_coset;
+        // HLT does not push the relations through every coset that it
+        // defines, and so there may be deductions that were never made, just
+        // as if they had been discarded.
+        _deductions_discarded = true;
       }
       _state = state::felsch;
-      while (_current != first_free_coset() && !stopped()) {
+      while (_current != first_free_coset() && !stopped()
+             && !_switched_to_hlt) {
         for (letter_type a = 0; a < n; ++a) {
           if (_table.get(_current, a) == UNDEFINED) {
             define<StackDeductions>(_current, a, new_coset());
             process_deductions();
 #ifdef LIBSEMIGROUPS_DEBUG
-            if (_settings->enable_debug_verify_no_missing_deductions) {
+            if (_settings->enable_debug_verify_no_missing_deductions
+                && !_deductions_discarded) {
               debug_verify_no_missing_deductions();
             }
 #endif
@@ -1160,13 +1629,47 @@ namespace libsemigroups {
             standardize_immediate(_current, t, a);
           }
         }
+        if (compaction_due()) {
+          compact();
+        }
         if (report()) {
           TODD_COXETER_REPORT_COSETS()
+          if (!_checkpoint.empty()) {
+            auto_checkpoint();
+          }
         }
         _current = next_active_coset(_current);
       }
       LIBSEMIGROUPS_ASSERT(_coinc.empty());
       LIBSEMIGROUPS_ASSERT(_deduct.empty());
+      if (_switched_to_hlt) {
+        // The deduction policy is switch_to_hlt and the deduction stack
+        // overflowed.
+        REPORT_DEFAULT("too many deductions, switching to HLT...\n");
+        REPORT_TIME(tmr);
+        hlt();
+        return;
+      }
+      if (!stopped() && _deductions_discarded) {
+        // The table is complete but, since some deductions were discarded,
+        // it might not be compatible with the relations.
+        REPORT_DEFAULT("some deductions were discarded, checking the "
+                       "table...\n");
+        policy::lookahead const lookahead = _settings->lookahead;
+        _settings->lookahead              = policy::lookahead::full;
+        size_t nr_killed;
+        do {
+          nr_killed = nr_cosets_killed();
+          perform_lookahead();
+        } while (nr_killed != nr_cosets_killed() && !stopped());
+        _settings->lookahead = lookahead;
+        if (!stopped()) {
+          _deductions_discarded = false;
+          // The lookahead does not define any new cosets, and so every
+          // active coset has already been visited.
+          _current = first_free_coset();
+        }
+      }
       if (!stopped()) {
         LIBSEMIGROUPS_ASSERT(_current == first_free_coset());
         _state = state::finished;
@@ -1183,7 +1686,9 @@ namespace libsemigroups {
                      _settings->standardize ? "with" : "without",
                      _settings->lookahead == policy::lookahead::partial
                          ? "partial"
-                         : "full",
+                         : (_settings->lookahead == policy::lookahead::full
+                                ? "full"
+                                : "parallel"),
                      _settings->save ? " " : " no ");
       detail::Timer tmr;
       init();
@@ -1242,6 +1747,9 @@ namespace libsemigroups {
         if (nr_cosets_active() > _settings->next_lookahead) {
           perform_lookahead();
         }
+        if (compaction_due()) {
+          compact();
+        }
         if (_settings->standardize) {
           size_t const n = nr_generators();
           for (letter_type x = 0; x < n; ++x) {
@@ -1250,6 +1758,9 @@ namespace libsemigroups {
         }
         if (report()) {
           TODD_COXETER_REPORT_COSETS()
+          if (!_checkpoint.empty()) {
+            auto_checkpoint();
+          }
         }
         _current = next_active_coset(_current);
       }
@@ -1264,6 +1775,82 @@ namespace libsemigroups {
       report_why_we_stopped();
     }
 
+    // Every configuration is run on its own copy of this, and so the relations
+    // (but not any parent FroidurePin, which is shared) are copied once per
+    // configuration. The coset table, which is usually much larger than the
+    // relations, is adopted from the winner by swapping.
+    void ToddCoxeter::portfolio() {
+      size_t const nr_threads = _settings->max_threads;
+      if (nr_threads == 1) {
+        // A detail::Race with a single thread declares its first runner the
+        // winner even if it did not finish, and so we use HLT instead.
+        hlt();
+        return;
+      }
+      if (_portfolio == nullptr) {
+        REPORT_DEFAULT("performing portfolio strategy...\n");
+        static constexpr std::array<bool, 5> use_felsch
+            = {false, true, false, false, false};
+        static constexpr std::array<bool, 5> full
+            = {false, false, true, true, false};
+        static constexpr std::array<bool, 5> save_it
+            = {false, false, true, false, true};
+
+        init();
+        _portfolio = detail::make_unique<detail::Race>();
+        for (size_t i = 0;
+             i < use_felsch.size() && _portfolio->number_runners() < nr_threads;
+             ++i) {
+          auto tc = std::make_shared<ToddCoxeter>(*this);
+          try {
+            if (use_felsch[i]) {
+              tc->strategy(policy::strategy::felsch);
+            } else {
+              tc->strategy(policy::strategy::hlt);
+              tc->lookahead(full[i] ? policy::lookahead::full
+                                    : policy::lookahead::partial);
+              tc->save(save_it[i]);
+            }
+          } catch (...) {
+            // It isn't always possible to use the Felsch strategy or the save
+            // option (when this is created from a Cayley table, for
+            // instance), and ToddCoxeter::strategy and ToddCoxeter::save
+            // throw if this is the case.
+            continue;
+          }
+          _portfolio->add_runner(tc);
+        }
+        // At least the two HLT configurations without deduction processing
+        // are always possible.
+        LIBSEMIGROUPS_ASSERT(_portfolio->number_runners() > 1);
+        _portfolio->max_threads(_portfolio->number_runners());
+      }
+      _portfolio->run_until([this]() -> bool { return stopped(); });
+      if (_portfolio->finished()) {
+        auto tc = std::static_pointer_cast<ToddCoxeter>(_portfolio->winner());
+        LIBSEMIGROUPS_ASSERT(tc->finished());
+        REPORT_DEFAULT("adopting the coset table of the winner...\n");
+        swap_cosets(*tc);
+        _table.swap(tc->_table);
+        _preim_init.swap(tc->_preim_init);
+        _preim_next.swap(tc->_preim_next);
+        _relations.swap(tc->_relations);
+        _extra.swap(tc->_extra);
+        std::swap(_coinc, tc->_coinc);
+        _deduct.swap(tc->_deduct);
+        _dfs.clear();
+        std::swap(_felsch_tree, tc->_felsch_tree);
+        std::swap(_tree, tc->_tree);
+        _deductions_discarded    = tc->_deductions_discarded;
+        _nr_killed_at_compaction = tc->_nr_killed_at_compaction;
+        _standardized            = tc->_standardized;
+        _switched_to_hlt         = tc->_switched_to_hlt;
+        _state                   = state::finished;
+        _portfolio.reset();
+      }
+      report_why_we_stopped();
+    }
+
     // This is not exactly Sim's TEN_CE, since all of the variants of
     // Todd-Coxeter represented in TEN_CE (that apply to semigroups/monoids)
     // are already accounted for in the above.
@@ -1333,7 +1920,10 @@ namespace libsemigroups {
     void ToddCoxeter::perform_lookahead() {
       state const old_state = _state;
       _state                = state::lookahead;
-      if (_settings->lookahead == policy::lookahead::partial) {
+      if (_settings->lookahead == policy::lookahead::parallel) {
+        REPORT_DEFAULT("performing parallel lookahead (%d threads)...\n",
+                       _settings->max_threads);
+      } else if (_settings->lookahead == policy::lookahead::partial) {
         REPORT_DEFAULT("performing partial lookahead...\n");
         // Start lookahead from the coset after _current
         _current_la = next_active_coset(_current);
@@ -1346,19 +1936,76 @@ namespace libsemigroups {
       TODD_COXETER_REPORT_COSETS()
 
       size_t nr_killed = nr_cosets_killed();
-      while (_current_la != first_free_coset()
-             // when running the random sims method the state is finished at
-             // this point, and so stopped() == true, but we anyway want to
-             // perform a full lookahead, which is why "_state ==
-             // state::finished" is in the next line.
-             && (old_state == state::finished || !stopped())) {
-        for (auto it = _relations.cbegin(); it < _relations.cend(); it += 2) {
-          push_definition_felsch<DoNotStackDeductions, ProcessCoincidences>(
-              _current_la, *it, *(it + 1));
-        }
-        _current_la = next_active_coset(_current_la);
-        if (report()) {
-          TODD_COXETER_REPORT_COSETS()
+      // when running the random sims method the state is finished at this
+      // point, and so stopped() == true, but we anyway want to perform a full
+      // lookahead, which is why "_state == state::finished" is checked here.
+      bool const stoppable = (old_state != state::finished);
+      if (_settings->lookahead == policy::lookahead::parallel) {
+        size_t const N = _settings->max_threads;
+        std::vector<std::vector<std::pair<coset_type, size_t>>> found(N);
+        std::vector<coset_type>                                 active;
+        size_t                                                  phase = 0;
+        size_t                                                  nr_found;
+        do {
+          size_t const nr_killed_phase = nr_cosets_killed();
+          active.clear();
+          for (coset_type c = _id_coset; c != first_free_coset();
+               c            = next_active_coset(c)) {
+            active.push_back(c);
+          }
+          size_t const n = active.size();
+          if (N == 1) {
+            lookahead_scan(active, 0, n, stoppable, found[0]);
+          } else {
+            std::vector<std::thread> threads;
+            for (size_t t = 0; t < N; ++t) {
+              threads.emplace_back(&ToddCoxeter::lookahead_scan,
+                                   this,
+                                   std::cref(active),
+                                   (t * n) / N,
+                                   ((t + 1) * n) / N,
+                                   stoppable,
+                                   std::ref(found[t]));
+            }
+            for (size_t t = 0; t < N; ++t) {
+              threads[t].join();
+            }
+          }
+          // The table is not modified until all of the threads are finished,
+          // at which point every relation found to imply a new value in the
+          // table, or a coincidence, is pushed through its coset again in a
+          // single thread, exactly as in a full lookahead. No coset is killed
+          // until all of these have been pushed, since coincidences are only
+          // processed afterwards.
+          nr_found = 0;
+          for (auto& pairs : found) {
+            nr_found += pairs.size();
+            for (auto const& p : pairs) {
+              auto const it = _relations.cbegin() + p.second;
+              push_definition_felsch<DoNotStackDeductions,
+                                     DoNotProcessCoincidences>(
+                  p.first, *it, *(it + 1));
+            }
+            pairs.clear();
+          }
+          process_coincidences<DoNotStackDeductions>();
+          REPORT_DEFAULT("phase %d: %d relations pushed, %d cosets killed\n",
+                         ++phase,
+                         nr_found,
+                         nr_cosets_killed() - nr_killed_phase);
+        } while (nr_found != 0 && (!stoppable || !stopped()));
+      } else {
+        while (_current_la != first_free_coset()
+               && (!stoppable || !stopped())) {
+          for (auto it = _relations.cbegin(); it < _relations.cend();
+               it += 2) {
+            push_definition_felsch<DoNotStackDeductions, ProcessCoincidences>(
+                _current_la, *it, *(it + 1));
+          }
+          _current_la = next_active_coset(_current_la);
+          if (report()) {
+            TODD_COXETER_REPORT_COSETS()
+          }
         }
       }
       nr_killed = nr_cosets_killed() - nr_killed;
@@ -1370,6 +2017,142 @@ namespace libsemigroups {
       _state = old_state;
     }
 
+    // Traces every relation at the cosets active[first], ...,
+    // active[last - 1] without modifying the coset table, and stores in found
+    // the pairs (c, i) such that pushing the coset c through the relation
+    // _relations[i] = _relations[i + 1] with push_definition_felsch would
+    // define a new value in the table or find a coincidence. This is called
+    // concurrently from several threads by perform_lookahead, and so must only
+    // read from this.
+    void ToddCoxeter::lookahead_scan(
+        std::vector<coset_type> const&              active,
+        size_t                                      first,
+        size_t                                      last,
+        bool                                        stoppable,
+        std::vector<std::pair<coset_type, size_t>>& found) const {
+      for (size_t i = first; i < last && (!stoppable || !stopped()); ++i) {
+        coset_type const c = active[i];
+        LIBSEMIGROUPS_ASSERT(is_active_coset(c));
+        for (auto it = _relations.cbegin(); it < _relations.cend(); it += 2) {
+          coset_type const x = tau(c, it->cbegin(), it->cend() - 1);
+          if (x == UNDEFINED) {
+            continue;
+          }
+          coset_type const y = tau(c, (it + 1)->cbegin(), (it + 1)->cend() - 1);
+          if (y == UNDEFINED) {
+            continue;
+          }
+          coset_type const xa = tau(x, it->back());
+          coset_type const yb = tau(y, (it + 1)->back());
+          if (xa != yb) {
+            found.emplace_back(c, it - _relations.cbegin());
+          }
+        }
+      }
+    }
+
+    bool ToddCoxeter::compaction_due() const noexcept {
+      // Compacting the table would undo the partial standardization performed
+      // by standardize_immediate. The cost of compacting is proportional to
+      // nr_cosets_active(), and so we only compact if at least this many
+      // cosets were killed since the last compaction.
+      return !_settings->standardize
+             && nr_cosets_active()
+                    < _settings->compaction_ratio * coset_capacity()
+             && nr_cosets_killed() - _nr_killed_at_compaction
+                    >= nr_cosets_active();
+    }
+
+    // Relocates every active coset c >= nr_cosets_active() to a free coset
+    // d < nr_cosets_active(), so that the active cosets occupy the rows [0,
+    // nr_cosets_active()) of _table, _preim_init, and _preim_next. Unlike
+    // apply_permutation, which is used when standardizing, nothing here is
+    // proportional to coset_capacity(), which can be much larger than
+    // nr_cosets_active() after a collapse: the rows of the moved cosets are
+    // swapped, the active rows are relabelled in a single sequential pass,
+    // and the memory used is proportional to the largest active coset minus
+    // nr_cosets_active().
+    // The position of every coset in the list of active cosets is unchanged,
+    // and so it is safe to call this in the middle of an enumeration, provided
+    // that there are no coincidences or deductions waiting to be processed.
+    void ToddCoxeter::compact() {
+      LIBSEMIGROUPS_ASSERT(_coinc.empty());
+      LIBSEMIGROUPS_ASSERT(_deduct.empty());
+      _nr_killed_at_compaction = nr_cosets_killed();
+      REPORT_DEFAULT("compacting the coset table...\n");
+      detail::Timer    tmr;
+      coset_type const n = nr_cosets_active();
+
+      // The active cosets c >= n are moved to the free cosets d < n, and
+      // new_index[c - n] = d.
+      std::vector<coset_type> from;
+      coset_type              max = n;
+      for (coset_type c = _id_coset; c != first_free_coset();
+           c            = next_active_coset(c)) {
+        if (c >= n) {
+          from.push_back(c);
+          max = std::max(max, c);
+        }
+      }
+      size_t const m = from.size();
+      if (m != 0) {
+        std::vector<coset_type> new_index(max + 1 - n,
+                                          static_cast<coset_type>(UNDEFINED));
+        coset_type              d = _id_coset;
+        for (coset_type c : from) {
+          do {
+            ++d;
+          } while (is_active_coset(d));
+          LIBSEMIGROUPS_ASSERT(d < n);
+          new_index[c - n] = d;
+          _table.swap_rows(c, d);
+          _preim_init.swap_rows(c, d);
+          _preim_next.swap_rows(c, d);
+        }
+        // Every value in an active row is UNDEFINED or an active coset, and
+        // so every value >= n belongs to from. The only exception is
+        // _preim_next(c, x) when _table(c, x) is UNDEFINED, which is not part
+        // of any list of preimages, and may be left over from a coset that
+        // was killed, since new_coset does not clear it. Such values are
+        // never read, and so they are not relabelled.
+        auto relabel = [&new_index, &n](
+                           InternalTable& tab, coset_type c, letter_type x) {
+          coset_type const e = tab.get(c, x);
+          if (e != UNDEFINED && e >= n) {
+            LIBSEMIGROUPS_ASSERT(new_index[e - n] != UNDEFINED);
+            tab.set(c, x, new_index[e - n]);
+          }
+        };
+        size_t const k = nr_generators();
+        for (coset_type c = _id_coset; c < n; ++c) {
+          for (letter_type x = 0; x < k; ++x) {
+            if (_table.get(c, x) != UNDEFINED) {
+              relabel(_table, c, x);
+              relabel(_preim_next, c, x);
+            }
+            relabel(_preim_init, c, x);
+          }
+        }
+        for (coset_type c : from) {
+          switch_cosets(c, new_index[c - n]);
+        }
+      }
+      REPORT_DEFAULT("%d cosets moved\n", m);
+      REPORT_TIME(tmr);
+#ifdef LIBSEMIGROUPS_DEBUG
+      debug_validate_forwd_bckwd();
+      debug_validate_table();
+#endif
+    }
+
+    void ToddCoxeter::auto_checkpoint() {
+      save_checkpoint(_checkpoint);
+      // Writing the checkpoint may take longer than the interval between
+      // reports, so the interval is restarted here, or else the enumeration
+      // would make almost no progress between checkpoints.
+      report_every(report_every());
+    }
+
     ////////////////////////////////////////////////////////////////////////
     // ToddCoxeter - member functions (standardize) - private
     ////////////////////////////////////////////////////////////////////////
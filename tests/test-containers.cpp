@@ -16,10 +16,17 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 //
 
-#include <numeric>  // for iota
+#include <array>       // for array
+#include <cstdint>     // for uint32_t, uintptr_t
+#include <functional>  // for hash
+#include <numeric>     // for iota
+#include <string>      // for string, to_string
+#include <utility>     // for move
 
 #include "catch.hpp"
 #include "containers.hpp"
+#include "libsemigroups-exception.hpp"
+#include "mmap-allocator.hpp"
 #include "test-main.hpp"
 
 namespace libsemigroups {
@@ -1601,6 +1608,240 @@ namespace libsemigroups {
       REQUIRE(std::vector<size_t>(rry.begin(2), rry.end(2))
               == std::vector<size_t>({11, 11, 11}));
     }
+
+    LIBSEMIGROUPS_TEST_CASE("FlatHashIndex",
+                            "044",
+                            "insert, find, reserve, clear",
+                            "[containers][quick]") {
+      // The keys are stored elsewhere, the index only stores their positions
+      std::vector<std::string> keys;
+      FlatHashIndex<size_t>    index;
+      std::hash<std::string>   hash;
+
+      auto find = [&keys, &index, &hash](std::string const& x) -> size_t {
+        return index.find(hash(x),
+                          [&keys, &x](size_t i) { return keys[i] == x; });
+      };
+
+      REQUIRE(index.empty());
+      REQUIRE(index.capacity() == 0);
+      REQUIRE(find("a") == UNDEFINED);
+
+      for (size_t i = 0; i < 1000; ++i) {
+        keys.push_back(std::to_string(i));
+        index.insert(hash(keys.back()), i);
+      }
+      REQUIRE(index.size() == 1000);
+      REQUIRE(index.capacity() >= 1000);
+      for (size_t i = 0; i < 1000; ++i) {
+        REQUIRE(find(std::to_string(i)) == i);
+      }
+      REQUIRE(find("1000") == UNDEFINED);
+      REQUIRE(find("a") == UNDEFINED);
+
+      // All keys have the same hash value
+      FlatHashIndex<size_t> copy(index);
+      index.clear();
+      REQUIRE(index.empty());
+      REQUIRE(find("0") == UNDEFINED);
+      for (size_t i = 0; i < 100; ++i) {
+        index.insert(0, i);
+      }
+      for (size_t i = 0; i < 100; ++i) {
+        REQUIRE(index.find(
+                    0, [&keys, i](size_t j) { return keys[j] == keys[i]; })
+                == i);
+      }
+      REQUIRE(index.find(1, [](size_t) { return true; }) == UNDEFINED);
+
+      // The copy is unaffected
+      REQUIRE(copy.size() == 1000);
+      REQUIRE(copy.find(hash("999"),
+                        [&keys](size_t i) { return keys[i] == "999"; })
+              == 999);
+
+      FlatHashIndex<uint32_t> small;
+      small.reserve(100);
+      size_t const cap = small.capacity();
+      for (uint32_t i = 0; i < 100; ++i) {
+        small.insert(i, i);
+      }
+      REQUIRE(small.capacity() == cap);
+      REQUIRE(small.find(42, [](uint32_t j) { return j == 42; }) == 42);
+      size_t nr_probes = 0;
+      REQUIRE(small.find(42, [](uint32_t j) { return j == 42; }, nr_probes)
+              == 42);
+      REQUIRE(nr_probes >= 1);
+      REQUIRE(small.find(1000, [](uint32_t) { return false; }, nr_probes)
+              == UNDEFINED);
+      REQUIRE(nr_probes >= 1);
+    }
+
+    LIBSEMIGROUPS_TEST_CASE("Arena",
+                            "045",
+                            "copy, operator[], move",
+                            "[containers][quick]") {
+      using value_type = std::array<uint32_t, 5>;
+      Arena<value_type>        arena;
+      std::vector<value_type*> ptrs;
+      REQUIRE(arena.size() == 0);
+      for (uint32_t i = 0; i < 10000; ++i) {
+        ptrs.push_back(arena.copy({i, i + 1, i + 2, i + 3, i + 4}));
+        // The start of every block is aligned to a cache line
+        if (i == 0) {
+          REQUIRE(reinterpret_cast<uintptr_t>(ptrs.back())
+                      % Arena<value_type>::cache_line_size
+                  == 0);
+        }
+      }
+      REQUIRE(arena.size() == 10000);
+      // Consecutive objects within the first block are adjacent
+      REQUIRE(ptrs[1] == ptrs[0] + 1);
+      REQUIRE(ptrs[63] == ptrs[0] + 63);
+
+      Arena<value_type> other(std::move(arena));
+      REQUIRE(arena.size() == 0);
+      REQUIRE(other.size() == 10000);
+      for (uint32_t i = 0; i < 10000; ++i) {
+        REQUIRE(other[i] == ptrs[i]);
+        REQUIRE((*ptrs[i])[0] == i);
+        REQUIRE((*ptrs[i])[4] == i + 4);
+      }
+      ptrs.push_back(arena.copy({0, 0, 0, 0, 0}));
+      REQUIRE(arena.size() == 1);
+      REQUIRE(*arena[0] == value_type({0, 0, 0, 0, 0}));
+    }
+
+    LIBSEMIGROUPS_TEST_CASE("Arena",
+                            "047",
+                            "free",
+                            "[containers][quick]") {
+      using value_type = std::array<uint32_t, 5>;
+      Arena<value_type>        arena;
+      std::vector<value_type*> ptrs;
+      for (uint32_t i = 0; i < 1000; ++i) {
+        ptrs.push_back(arena.copy({i, i, i, i, i}));
+      }
+      // Blocks of 64, 128, 256, and 512 objects, and a partially filled block
+      // of 1024 objects.
+      REQUIRE(arena.nr_blocks() == 5);
+      for (uint32_t i = 0; i < 63; ++i) {
+        arena.free(ptrs[i]);
+      }
+      REQUIRE(arena.nr_blocks() == 5);
+      arena.free(ptrs[63]);
+      REQUIRE(arena.nr_blocks() == 4);
+      for (uint32_t i = 64; i < 1000; ++i) {
+        arena.free(ptrs[i]);
+      }
+      // The block currently being filled is never released.
+      REQUIRE(arena.nr_blocks() == 1);
+      REQUIRE(arena.size() == 1000);
+      ptrs.push_back(arena.copy({0, 0, 0, 0, 0}));
+      REQUIRE(*ptrs.back() == value_type({0, 0, 0, 0, 0}));
+      REQUIRE(arena.nr_blocks() == 1);
+    }
+
+    LIBSEMIGROUPS_TEST_CASE("BitArray2",
+                            "046",
+                            "get, set, add_rows, reset, next_unset, "
+                            "next_difference",
+                            "[containers][quick]") {
+      BitArray2 ba(70, 3);
+      REQUIRE(ba.nr_cols() == 70);
+      REQUIRE(ba.nr_rows() == 3);
+      REQUIRE(ba.nr_blocks_per_row() == 2);
+      for (size_t i = 0; i < 3; ++i) {
+        for (size_t j = 0; j < 70; ++j) {
+          REQUIRE(!ba.get(i, j));
+        }
+      }
+      ba.set(0, 0, true);
+      ba.set(0, 63, true);
+      ba.set(0, 64, true);
+      ba.set(1, 69, true);
+      REQUIRE(ba.get(0, 0));
+      REQUIRE(ba.get(0, 63));
+      REQUIRE(ba.get(0, 64));
+      REQUIRE(!ba.get(0, 1));
+      REQUIRE(!ba.get(1, 0));
+      REQUIRE(ba.get(1, 69));
+      ba.set(0, 63, false);
+      REQUIRE(!ba.get(0, 63));
+
+      REQUIRE(ba.next_unset(0, 0) == 1);
+      REQUIRE(ba.next_unset(0, 64) == 65);
+      REQUIRE(ba.next_unset(2, 5) == 5);
+      REQUIRE(ba.next_unset(1, 69) == 70);
+      REQUIRE(ba.next_unset(1, 100) == 70);
+      REQUIRE(ba.next_difference(0, 1, 0) == 0);
+      REQUIRE(ba.next_difference(0, 1, 1) == 64);
+      REQUIRE(ba.next_difference(0, 1, 65) == 70);
+      REQUIRE(ba.next_difference(1, 0, 0) == 69);
+      REQUIRE(ba.next_difference(2, 0, 0) == 70);
+
+      BitArray2 other(ba);
+      REQUIRE(other == ba);
+      ba.add_rows(2);
+      REQUIRE(ba.nr_rows() == 5);
+      REQUIRE(ba.get(0, 64));
+      REQUIRE(!ba.get(4, 64));
+      REQUIRE(other != ba);
+
+      ba.clear();
+      REQUIRE(ba.nr_rows() == 5);
+      REQUIRE(!ba.get(0, 64));
+      REQUIRE(ba.next_unset(0, 0) == 0);
+
+      ba.reset(3, 10);
+      REQUIRE(ba.nr_cols() == 3);
+      REQUIRE(ba.nr_rows() == 10);
+      REQUIRE(ba.nr_blocks_per_row() == 1);
+      ba.set(9, 2, true);
+      REQUIRE(ba.get(9, 2));
+      REQUIRE(ba.next_unset(9, 2) == 3);
+      REQUIRE(ba.next_difference(9, 8, 0) == 2);
+    }
+
+    LIBSEMIGROUPS_TEST_CASE("DynamicArray2",
+                            "048",
+                            "MmapAllocator",
+                            "[containers][quick]") {
+      using Alloc = MmapAllocator<size_t>;
+      using Array = DynamicArray2<size_t, Alloc>;
+
+      Array da(3, 2, 7, Alloc("."));
+      REQUIRE(da.get_allocator().directory() == ".");
+      REQUIRE(da.nr_rows() == 2);
+      REQUIRE(da.nr_cols() == 3);
+      REQUIRE(da.get(1, 2) == 7);
+      da.set(1, 2, 3);
+      da.add_rows(1000);
+      da.add_cols(2);
+      REQUIRE(da.nr_rows() == 1002);
+      REQUIRE(da.nr_cols() == 5);
+      REQUIRE(da.get(1, 2) == 3);
+      REQUIRE(da.get(1001, 4) == 7);
+
+      Array copy(da);
+      REQUIRE(copy.get_allocator() == da.get_allocator());
+      REQUIRE(copy == da);
+
+      Array mem(da, Alloc());
+      REQUIRE(mem.get_allocator().directory().empty());
+      REQUIRE(mem == da);
+      mem.swap(copy);
+      REQUIRE(mem.get_allocator().directory() == ".");
+      REQUIRE(copy.get_allocator().directory().empty());
+      copy = mem;
+      REQUIRE(copy.get_allocator().directory() == ".");
+      REQUIRE(copy == da);
+      da.shrink_rows_to(1);
+      REQUIRE(da == Array({{7, 7, 7, 7, 7}}));
+
+      REQUIRE_THROWS_AS(Array(2, 2, 0, Alloc("non-existent-dir")),
+                        LibsemigroupsException);
+    }
   }  // namespace detail
 
 }  // namespace libsemigroups
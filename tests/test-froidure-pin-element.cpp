@@ -3463,4 +3463,46 @@ namespace libsemigroups {
     delete_gens(additional_gens_2_1);
     delete_gens(additional_gens_2_2);
   }
+
+  LIBSEMIGROUPS_TEST_CASE("FroidurePin",
+                          "137",
+                          "copies share elements",
+                          "[quick][froidure-pin][element]") {
+    auto                  rg   = ReportGuard(REPORT);
+    std::vector<Element*> gens = {new Transformation<uint16_t>({1, 0, 2, 3, 4}),
+                                  new Transformation<uint16_t>({1, 2, 3, 4, 0})};
+    FroidurePin<Element const*>* S = new FroidurePin<Element const*>(gens);
+    delete_gens(gens);
+    REQUIRE(S->size() == 120);
+
+    FroidurePin<Element const*> T(*S);
+    std::vector<Element*> coll = {new Transformation<uint16_t>({0, 0, 2, 3, 4})};
+    FroidurePin<Element const*>* U = S->copy_add_generators(coll);
+    delete_gens(coll);
+    for (size_t i = 0; i < S->size(); ++i) {
+      REQUIRE(T.at(i) == S->at(i));
+      REQUIRE(U->at(i) == S->at(i));
+    }
+    delete S;
+
+    Element* x = new Transformation<uint16_t>({0, 1, 2, 4, 3});
+    REQUIRE(T.size() == 120);
+    REQUIRE(T.contains(x));
+    REQUIRE(U->size() == 3125);
+
+    coll = {new Transformation<uint16_t>({0, 1, 2, 3, 3})};
+    FroidurePin<Element const*>* V = T.copy_closure(coll);
+    delete_gens(coll);
+    for (size_t i = 0; i < T.size(); ++i) {
+      REQUIRE(V->at(i) == T.at(i));
+      REQUIRE(V->at(i) == U->at(i));
+    }
+    delete U;
+
+    REQUIRE(V->size() == 3125);
+    REQUIRE(V->nr_idempotents() == 196);
+    REQUIRE(V->position(x) == T.position(x));
+    delete V;
+    delete x;
+  }
 }  // namespace libsemigroups
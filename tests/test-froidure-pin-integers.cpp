@@ -18,7 +18,7 @@
 
 #include <cstddef>      // for size_t
 #include <cstdint>      // for uint8_t
-#include <type_traits>  // for enable_if, is_integral
+#include <type_traits>  // for enable_if, is_integral, is_same
 
 #include "adapters.hpp"             // for complexity etc
 #include "catch.hpp"                // for LIBSEMIGROUPS_TEST_CASE
@@ -108,4 +108,30 @@ namespace libsemigroups {
     REQUIRE(*T.cbegin_idempotents() == 0);
     REQUIRE(*T.cbegin_idempotents() + 1 == 1);
   }
+
+  // A traits class which does not derive from FroidurePinTraits, and so has
+  // no member Storage.
+  struct IntegerTraits {
+    using Complexity     = ::libsemigroups::Complexity<int>;
+    using Degree         = ::libsemigroups::Degree<int>;
+    using EqualTo        = ::libsemigroups::EqualTo<int>;
+    using Hash           = ::libsemigroups::Hash<int>;
+    using IncreaseDegree = ::libsemigroups::IncreaseDegree<int>;
+    using Less           = ::libsemigroups::Less<int>;
+    using One            = ::libsemigroups::One<int>;
+    using Product        = ::libsemigroups::Product<int>;
+    using Swap           = ::libsemigroups::Swap<int>;
+  };
+
+  LIBSEMIGROUPS_TEST_CASE("FroidurePin",
+                          "141",
+                          "(integers) traits class without Storage",
+                          "[quick][froidure-pin][integers]") {
+    auto                            rg = ReportGuard(REPORT);
+    FroidurePin<int, IntegerTraits> S({2});
+    REQUIRE(std::is_same<FroidurePin<int, IntegerTraits>::Storage,
+                         detail::FroidurePinHeapStorage<int>>::value);
+    REQUIRE(S.size() == 32);
+    REQUIRE(S.nr_idempotents() == 1);
+  }
 }  // namespace libsemigroups
@@ -16,8 +16,9 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 //
 
+#include <algorithm>    // for all_of, equal
 #include <cstddef>      // for size_t
-#include <type_traits>  // for integral_constant<>::value
+#include <type_traits>  // for integral_constant<>::value, is_same
 
 #include "adapters.hpp"             // for complexity etc
 #include "catch.hpp"                // for LIBSEMIGROUPS_TEST_CASE
@@ -123,4 +124,35 @@ namespace libsemigroups {
     REQUIRE(S.size() == 1);
     REQUIRE(S.nr_idempotents() == 1);
   }
+
+  static_assert(std::is_same<FroidurePin<IntPair>::Storage,
+                             detail::FroidurePinArenaStorage<IntPair>>::value,
+                "IntPair should be stored in an arena");
+
+  LIBSEMIGROUPS_TEST_CASE("FroidurePin",
+                          "127",
+                          "(pairs of integers) arena storage",
+                          "[quick][froidure-pin][intpairs]") {
+    auto                 rg = ReportGuard(REPORT);
+    FroidurePin<IntPair> S({IntPair(-1, 1), IntPair(0, 1)});
+    REQUIRE(S.size() == 3);
+    REQUIRE(S.position(IntPair(1, 1)) == 2);
+
+    FroidurePin<IntPair> T(S);
+    REQUIRE(T.size() == 3);
+    REQUIRE(std::equal(S.cbegin(), S.cend(), T.cbegin()));
+
+    T.add_generator(IntPair(1, -1));
+    REQUIRE(T.size() == 6);
+    REQUIRE(T.contains(IntPair(0, -1)));
+    REQUIRE(T.contains(IntPair(-1, -1)));
+    REQUIRE(S.size() == 3);
+
+    FroidurePin<IntPair> U(S);
+    U.closure({IntPair(1, -1), IntPair(-1, 1)});
+    REQUIRE(U.size() == 6);
+    REQUIRE(std::all_of(T.cbegin(), T.cend(), [&U](IntPair const& x) {
+      return U.contains(x);
+    }));
+  }
 }  // namespace libsemigroups
@@ -0,0 +1,150 @@
+//
+// libsemigroups - C++ library for semigroups and monoids
+// Copyright (C) 2019 James D. Mitchell
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <cstddef>  // for size_t
+#include <cstdint>  // for uint_fast8_t
+#include <vector>   // for vector
+
+#include "catch.hpp"          // for REQUIRE, REQUIRE_THROWS_AS
+#include "element.hpp"        // for Transformation, PartialPerm
+#include "froidure-pin.hpp"   // for FroidurePin
+#include "konieczny.hpp"      // for Konieczny
+#include "report.hpp"         // for ReportGuard
+#include "test-main.hpp"      // for LIBSEMIGROUPS_TEST_CASE
+
+namespace libsemigroups {
+  struct LibsemigroupsException;
+
+  constexpr bool REPORT = false;
+
+  LIBSEMIGROUPS_TEST_CASE("Konieczny",
+                          "001",
+                          "full transformation monoid degree 5",
+                          "[quick][konieczny][transformation]") {
+    auto rg      = ReportGuard(REPORT);
+    using Transf = Transformation<uint_fast8_t>;
+    Konieczny<5, Transf> K({Transf({1, 0, 2, 3, 4}),
+                            Transf({1, 2, 3, 4, 0}),
+                            Transf({0, 0, 2, 3, 4})});
+    REQUIRE(K.size() == 3125);
+    REQUIRE(K.nr_idempotents() == 196);
+    REQUIRE(K.nr_D_classes() == 5);
+    REQUIRE(K.nr_R_classes() == 52);
+    REQUIRE(K.nr_L_classes() == 31);
+    REQUIRE(K.nr_H_classes() == 456);
+    REQUIRE(K.lambda_orb().current_size() == 31);
+    REQUIRE(K.rho_orb().current_size() == 52);
+    REQUIRE(K.contains(Transf({0, 0, 0, 0, 0})));
+    REQUIRE(K.contains(Transf({4, 3, 2, 1, 0})));
+    REQUIRE(!K.contains(Transf({0, 1, 2, 3})));
+  }
+
+  LIBSEMIGROUPS_TEST_CASE("Konieczny",
+                          "002",
+                          "symmetric inverse monoid degree 4",
+                          "[quick][konieczny][pperm]") {
+    auto rg     = ReportGuard(REPORT);
+    using PPerm = PartialPerm<uint_fast8_t>;
+    Konieczny<4, PPerm> K({PPerm({0, 1, 2, 3}, {1, 0, 2, 3}, 4),
+                           PPerm({0, 1, 2, 3}, {1, 2, 3, 0}, 4),
+                           PPerm({1, 2, 3}, {1, 2, 3}, 4)});
+    REQUIRE(K.size() == 209);
+    REQUIRE(K.nr_idempotents() == 16);
+    REQUIRE(K.nr_D_classes() == 5);
+    REQUIRE(K.nr_R_classes() == 16);
+    REQUIRE(K.nr_L_classes() == 16);
+    REQUIRE(K.nr_H_classes() == 70);
+    REQUIRE(K.contains(PPerm({0, 2}, {3, 1}, 4)));
+    REQUIRE(K.contains(PPerm(std::vector<uint_fast8_t>({}),
+                             std::vector<uint_fast8_t>({}),
+                             4)));
+    REQUIRE(!K.contains(PPerm({0, 1}, {0, 1}, 3)));
+  }
+
+  LIBSEMIGROUPS_TEST_CASE("Konieczny",
+                          "003",
+                          "non-regular transformation semigroup",
+                          "[quick][konieczny][transformation]") {
+    auto rg      = ReportGuard(REPORT);
+    using Transf = Transformation<uint_fast8_t>;
+    std::vector<Transf> gens = {Transf({1, 3, 4, 2, 3}),
+                                Transf({3, 2, 1, 3, 3}),
+                                Transf({0, 4, 0, 1, 1})};
+    FroidurePin<Transf>  S(gens);
+    Konieczny<8, Transf> K(gens);
+
+    REQUIRE(K.size() == S.size());
+    REQUIRE(K.nr_idempotents() == S.nr_idempotents());
+    for (auto it = S.cbegin(); it < S.cend(); ++it) {
+      REQUIRE(K.contains(*it));
+    }
+    // Compare membership with FroidurePin for every transformation of degree
+    // 5.
+    std::vector<uint_fast8_t> imgs(5, 0);
+    size_t                    nr = 0;
+    for (size_t i = 0; i < 3125; ++i) {
+      for (size_t j = 0, k = i; j < 5; ++j, k /= 5) {
+        imgs[j] = k % 5;
+      }
+      Transf x(imgs);
+      REQUIRE(K.contains(x) == (S.position(x) != UNDEFINED));
+      nr += K.contains(x);
+    }
+    REQUIRE(nr == S.size());
+  }
+
+  LIBSEMIGROUPS_TEST_CASE("Konieczny",
+                          "004",
+                          "(transformations) JDM favourite",
+                          "[standard][konieczny][transformation]") {
+    auto rg      = ReportGuard(REPORT);
+    using Transf = Transformation<uint_fast8_t>;
+    Konieczny<8, Transf> K({Transf({1, 7, 2, 6, 0, 4, 1, 5}),
+                            Transf({2, 4, 6, 1, 4, 5, 2, 7}),
+                            Transf({3, 0, 7, 2, 4, 6, 2, 4}),
+                            Transf({3, 2, 3, 4, 5, 3, 0, 1}),
+                            Transf({4, 3, 7, 7, 4, 5, 0, 4}),
+                            Transf({5, 6, 3, 0, 3, 0, 5, 1}),
+                            Transf({6, 0, 1, 1, 1, 6, 3, 4}),
+                            Transf({7, 7, 4, 0, 6, 4, 1, 7})});
+    REQUIRE(K.size() == 597369);
+    REQUIRE(K.nr_idempotents() == 8194);
+    REQUIRE(K.contains(Transf({0, 4, 7, 2, 3, 4, 0, 6})));
+    REQUIRE(!K.contains(Transf({7, 1, 2, 6, 7, 4, 1, 5})));
+  }
+
+  LIBSEMIGROUPS_TEST_CASE("Konieczny",
+                          "005",
+                          "exceptions",
+                          "[quick][konieczny]") {
+    auto rg      = ReportGuard(REPORT);
+    using Transf = Transformation<uint_fast8_t>;
+    Konieczny<4, Transf> K;
+    REQUIRE(K.size() == 0);
+    REQUIRE(!K.contains(Transf({0, 1, 2})));
+    REQUIRE_THROWS_AS(K.add_generator(Transf({0, 1, 2, 3, 4})),
+                      LibsemigroupsException);
+    K.add_generator(Transf({1, 0, 2}));
+    REQUIRE_THROWS_AS(K.add_generator(Transf({0, 1, 2, 3})),
+                      LibsemigroupsException);
+    REQUIRE(K.size() == 2);
+    REQUIRE(K.nr_D_classes() == 1);
+    REQUIRE_THROWS_AS(K.add_generator(Transf({0, 0, 2})),
+                      LibsemigroupsException);
+  }
+}  // namespace libsemigroups
@@ -23,9 +23,17 @@
 #include <algorithm>   // for count, sort, transform
 #include <chrono>      // for duration, milliseconds
 #include <cstddef>     // for size_t
+#include <cstdint>     // for uint64_t
+#include <cstdio>      // for remove
+#include <cstring>     // for memcpy
+#include <fstream>     // for ifstream, ofstream
 #include <functional>  // for mem_fn
+#include <iterator>    // for istreambuf_iterator
+#include <sstream>     // for istringstream
+#include <string>      // for string
 #include <vector>      // for vector
 
+#include "binary-io.hpp"        // for checksum
 #include "bmat8.hpp"            // for Bmat8
 #include "catch.hpp"            // for SECTION, REQUIRE, REQUIRE_THROWS_AS
 #include "cong-intf.hpp"        // for congruence::type
@@ -122,6 +130,14 @@
     var.strategy(policy::strategy::random); \
   }
 
+#define TEST_PORTFOLIO(var)                                   \
+  SECTION("portfolio strategy") {                             \
+    var.strategy(policy::strategy::portfolio).max_threads(4); \
+  }                                                           \
+  SECTION("portfolio strategy (1 thread)") {                  \
+    var.strategy(policy::strategy::portfolio).max_threads(1); \
+  }
+
 namespace libsemigroups {
   struct LibsemigroupsException;  // Forward declaration
 
@@ -516,6 +532,7 @@ namespace libsemigroups {
       TEST_HLT_SAVE_THROWS(tc);
       TEST_FELSCH_THROWS(tc);
       TEST_RANDOM_SIMS(tc);
+      TEST_PORTFOLIO(tc);
 
       REQUIRE(tc.nr_classes() == 21);
       tc.shrink_to_fit();
@@ -807,6 +824,7 @@ namespace libsemigroups {
       TEST_HLT_SAVE_THROWS(tc);
       TEST_FELSCH_THROWS(tc);
       TEST_RANDOM_SIMS(tc);
+      TEST_PORTFOLIO(tc);
 
       REQUIRE(tc.nr_classes() == 21);
       REQUIRE(tc.nr_classes() == 21);
@@ -1124,6 +1142,7 @@ namespace libsemigroups {
       TEST_HLT_SAVE_THROWS(tc);
       TEST_FELSCH_THROWS(tc);
       TEST_RANDOM_SIMS(tc);
+      TEST_PORTFOLIO(tc);
       REQUIRE(tc.nr_classes() == 69);
     }
 
@@ -1664,6 +1683,7 @@ namespace libsemigroups {
       TEST_HLT_SAVE_THROWS(tc);
       TEST_FELSCH_THROWS(tc);
       TEST_RANDOM_SIMS(tc);
+      TEST_PORTFOLIO(tc);
       tc.add_pair({0}, {1, 1});
       REQUIRE(tc.nr_classes() == 1);
     }
@@ -3557,5 +3577,381 @@ namespace libsemigroups {
       REQUIRE_THROWS_AS(tc.congruence().sort_generating_pairs(shortlex_compare),
                         LibsemigroupsException);
     }
+
+    LIBSEMIGROUPS_TEST_CASE("ToddCoxeter",
+                            "099",
+                            "Renner monoid type D4 (Gay-Hivert), q = 1 "
+                            "(deduction policies)",
+                            "[no-valgrind][quick][todd-coxeter]") {
+      auto        rg = ReportGuard(REPORT);
+      ToddCoxeter tc;
+      tc.set_alphabet(11);
+      for (relation_type const& rl : RennerTypeDMonoid(4, 1)) {
+        tc.add_rule(rl);
+      }
+      REQUIRE(tc.congruence().deduction_policy()
+              == policy::deductions::unlimited);
+      REQUIRE(tc.congruence().max_deductions() == 100000);
+
+      tc.congruence().strategy(policy::strategy::felsch).max_deductions(10);
+
+      SECTION("purge from top") {
+        tc.congruence().deduction_policy(policy::deductions::purge_from_top);
+      }
+      SECTION("purge all") {
+        tc.congruence().deduction_policy(policy::deductions::purge_all);
+      }
+      SECTION("discard all if no space") {
+        tc.congruence().deduction_policy(
+            policy::deductions::discard_all_if_no_space);
+      }
+      SECTION("switch to HLT") {
+        tc.congruence().deduction_policy(policy::deductions::switch_to_hlt);
+        REQUIRE(tc.size() == 10625);
+        REQUIRE(tc.congruence().strategy() == policy::strategy::felsch);
+      }
+      SECTION("switch to HLT + save") {
+        tc.congruence()
+            .deduction_policy(policy::deductions::switch_to_hlt)
+            .save(true);
+        REQUIRE(tc.size() == 10625);
+        REQUIRE(tc.congruence().strategy() == policy::strategy::felsch);
+      }
+      SECTION("switch to HLT + resumed") {
+        tc.congruence().deduction_policy(policy::deductions::switch_to_hlt);
+        tc.congruence().run_until([&tc]() -> bool {
+          return tc.congruence().nr_cosets_active() > 2000;
+        });
+        REQUIRE(tc.congruence().strategy() == policy::strategy::felsch);
+        congruence::ToddCoxeter tc2(tc.congruence());
+        REQUIRE(tc2.strategy() == policy::strategy::felsch);
+        REQUIRE(tc2.nr_classes() == 10625);
+        REQUIRE(tc2.complete());
+        REQUIRE(tc2.compatible());
+      }
+      REQUIRE(tc.size() == 10625);
+      REQUIRE(tc.congruence().complete());
+      REQUIRE(tc.congruence().compatible());
+    }
+
+    LIBSEMIGROUPS_TEST_CASE("ToddCoxeter",
+                            "100",
+                            "Renner monoid type D4 (Gay-Hivert), q = 1 "
+                            "(parallel lookahead)",
+                            "[no-valgrind][quick][todd-coxeter]") {
+      auto        rg = ReportGuard(REPORT);
+      ToddCoxeter tc;
+      tc.set_alphabet(11);
+      for (relation_type const& rl : RennerTypeDMonoid(4, 1)) {
+        tc.add_rule(rl);
+      }
+      REQUIRE(tc.congruence().max_threads() >= 1);
+      tc.congruence()
+          .lookahead(policy::lookahead::parallel)
+          .next_lookahead(1000);
+
+      SECTION("0 threads") {
+        tc.congruence().max_threads(0);
+        REQUIRE(tc.congruence().max_threads() == 1);
+      }
+      SECTION("4 threads") {
+        tc.congruence().max_threads(4);
+        REQUIRE(tc.congruence().max_threads() >= 1);
+        REQUIRE(tc.congruence().max_threads() <= 4);
+      }
+      SECTION("4 threads + save") {
+        tc.congruence().max_threads(4).save(true);
+      }
+      REQUIRE(tc.size() == 10625);
+      REQUIRE(tc.congruence().complete());
+      REQUIRE(tc.congruence().compatible());
+    }
+
+    LIBSEMIGROUPS_TEST_CASE("ToddCoxeter",
+                            "101",
+                            "Renner monoid type D4 (Gay-Hivert), q = 1 "
+                            "(compaction)",
+                            "[no-valgrind][quick][todd-coxeter]") {
+      auto        rg = ReportGuard(REPORT);
+      ToddCoxeter tc1;
+      ToddCoxeter tc2;
+      tc1.set_alphabet(11);
+      tc2.set_alphabet(11);
+      for (relation_type const& rl : RennerTypeDMonoid(4, 1)) {
+        tc1.add_rule(rl);
+        tc2.add_rule(rl);
+      }
+      REQUIRE(tc1.congruence().compaction_ratio() == 0.25);
+      tc1.congruence().compaction_ratio(0);
+      tc2.congruence().compaction_ratio(1);
+
+      SECTION("HLT") {
+        tc2.congruence().strategy(policy::strategy::hlt);
+      }
+      SECTION("HLT + save") {
+        tc2.congruence().strategy(policy::strategy::hlt).save(true);
+      }
+      SECTION("Felsch") {
+        tc2.congruence().strategy(policy::strategy::felsch);
+      }
+      REQUIRE(tc2.size() == 10625);
+      REQUIRE(tc2.congruence().complete());
+      REQUIRE(tc2.congruence().compatible());
+      tc2.congruence().shrink_to_fit();
+      REQUIRE(!tc2.congruence().is_standardized());
+      REQUIRE(tc2.size() == 10625);
+      REQUIRE(tc1.size() == 10625);
+      REQUIRE(std::vector<word_type>(tc1.congruence().cbegin_normal_forms(),
+                                     tc1.congruence().cend_normal_forms())
+              == std::vector<word_type>(tc2.congruence().cbegin_normal_forms(),
+                                        tc2.congruence().cend_normal_forms()));
+    }
+
+    LIBSEMIGROUPS_TEST_CASE("ToddCoxeter",
+                            "102",
+                            "Renner monoid type D4 (Gay-Hivert), q = 1 "
+                            "(checkpoints)",
+                            "[no-valgrind][quick][todd-coxeter]") {
+      auto              rg   = ReportGuard(REPORT);
+      std::string const file = "test-todd-coxeter-102.tmp";
+      ToddCoxeter       tc1;
+      ToddCoxeter       tc2;
+      ToddCoxeter       tc3;
+      tc1.set_alphabet(11);
+      tc2.set_alphabet(11);
+      tc3.set_alphabet(11);
+      for (relation_type const& rl : RennerTypeDMonoid(4, 1)) {
+        tc1.add_rule(rl);
+        tc2.add_rule(rl);
+        tc3.add_rule(rl);
+      }
+
+      SECTION("HLT") {
+        tc1.congruence().strategy(policy::strategy::hlt);
+      }
+      SECTION("HLT + save") {
+        tc1.congruence().strategy(policy::strategy::hlt).save(true);
+      }
+      SECTION("Felsch") {
+        tc1.congruence().strategy(policy::strategy::felsch);
+      }
+      tc1.congruence().run_until([&tc1]() -> bool {
+        return tc1.congruence().nr_cosets_active() > 2000;
+      });
+      REQUIRE(!tc1.congruence().finished());
+      tc1.congruence().save_checkpoint(file);
+
+      tc2.congruence().load_checkpoint(file);
+      REQUIRE(tc2.congruence().strategy() == tc1.congruence().strategy());
+      REQUIRE(tc2.congruence().nr_cosets_active()
+              == tc1.congruence().nr_cosets_active());
+      REQUIRE(tc2.size() == 10625);
+      REQUIRE(tc2.congruence().complete());
+      REQUIRE(tc2.congruence().compatible());
+      REQUIRE_THROWS_AS(tc2.congruence().load_checkpoint(file),
+                        LibsemigroupsException);
+
+      // Automatic checkpoints
+      tc1.congruence().checkpoint(file);
+      REQUIRE(tc1.congruence().checkpoint() == file);
+      std::remove(file.c_str());
+      tc1.congruence().report_every(std::chrono::milliseconds(1));
+      tc1.congruence().run_until([&tc1]() -> bool {
+        return tc1.congruence().nr_cosets_active() > 4000;
+      });
+      tc1.congruence().checkpoint("");
+      REQUIRE(tc1.congruence().checkpoint().empty());
+      tc3.congruence().load_checkpoint(file);
+      REQUIRE(tc3.size() == 10625);
+      REQUIRE(tc1.size() == 10625);
+      REQUIRE(std::vector<word_type>(tc1.congruence().cbegin_normal_forms(),
+                                     tc1.congruence().cend_normal_forms())
+              == std::vector<word_type>(tc3.congruence().cbegin_normal_forms(),
+                                        tc3.congruence().cend_normal_forms()));
+
+      // Incompatible instances
+      ToddCoxeter tc4;
+      tc4.set_alphabet(11);
+      REQUIRE_THROWS_AS(tc4.congruence().load_checkpoint(file),
+                        LibsemigroupsException);
+      congruence::ToddCoxeter tc5(left);
+      tc5.set_nr_generators(11);
+      REQUIRE_THROWS_AS(tc5.load_checkpoint(file), LibsemigroupsException);
+      REQUIRE_THROWS_AS(tc4.congruence().load_checkpoint("non-existent-file"),
+                        LibsemigroupsException);
+      std::remove(file.c_str());
+    }
+
+    LIBSEMIGROUPS_TEST_CASE("ToddCoxeter",
+                            "103",
+                            "Renner monoid type D4 (Gay-Hivert), q = 1 "
+                            "(tables in files)",
+                            "[no-valgrind][quick][todd-coxeter]") {
+      auto        rg = ReportGuard(REPORT);
+      ToddCoxeter tc1;
+      ToddCoxeter tc2;
+      tc1.set_alphabet(11);
+      tc2.set_alphabet(11);
+      for (relation_type const& rl : RennerTypeDMonoid(4, 1)) {
+        tc1.add_rule(rl);
+        tc2.add_rule(rl);
+      }
+      REQUIRE(tc2.congruence().table_directory().empty());
+      REQUIRE_THROWS_AS(
+          tc2.congruence().table_directory("non-existent-directory"),
+          LibsemigroupsException);
+      REQUIRE(tc2.congruence().table_directory().empty());
+      tc2.congruence().table_directory(".");
+      REQUIRE(tc2.congruence().table_directory() == ".");
+
+      SECTION("HLT") {
+        tc2.congruence().strategy(policy::strategy::hlt);
+      }
+      SECTION("HLT + save") {
+        tc2.congruence().strategy(policy::strategy::hlt).save(true);
+      }
+      SECTION("Felsch") {
+        tc2.congruence().strategy(policy::strategy::felsch);
+      }
+      tc2.congruence().run_until([&tc2]() -> bool {
+        return tc2.congruence().nr_cosets_active() > 2000;
+      });
+      congruence::ToddCoxeter tc3(tc2.congruence());
+      REQUIRE(tc3.table_directory() == ".");
+      tc3.table_directory("");
+      REQUIRE(tc3.table_directory().empty());
+
+      REQUIRE(tc2.size() == 10625);
+      REQUIRE(tc2.congruence().complete());
+      REQUIRE(tc2.congruence().compatible());
+      REQUIRE(tc3.nr_classes() == 10625);
+      REQUIRE(tc1.size() == 10625);
+      REQUIRE(std::vector<word_type>(tc1.congruence().cbegin_normal_forms(),
+                                     tc1.congruence().cend_normal_forms())
+              == std::vector<word_type>(tc2.congruence().cbegin_normal_forms(),
+                                        tc2.congruence().cend_normal_forms()));
+      tc2.congruence().table_directory("");
+      REQUIRE(std::vector<word_type>(tc2.congruence().cbegin_normal_forms(),
+                                     tc2.congruence().cend_normal_forms())
+              == std::vector<word_type>(tc3.cbegin_normal_forms(),
+                                        tc3.cend_normal_forms()));
+    }
+
+    LIBSEMIGROUPS_TEST_CASE("ToddCoxeter",
+                            "104",
+                            "Renner monoid type D4 (Gay-Hivert), q = 1 "
+                            "(portfolio strategy)",
+                            "[no-valgrind][quick][todd-coxeter]") {
+      auto        rg = ReportGuard(REPORT);
+      ToddCoxeter tc1;
+      ToddCoxeter tc2;
+      tc1.set_alphabet(11);
+      tc2.set_alphabet(11);
+      for (relation_type const& rl : RennerTypeDMonoid(4, 1)) {
+        tc1.add_rule(rl);
+        tc2.add_rule(rl);
+      }
+      tc2.congruence().strategy(policy::strategy::portfolio);
+      REQUIRE(tc2.congruence().strategy() == policy::strategy::portfolio);
+
+      SECTION("1 thread") {
+        tc2.congruence().max_threads(1);
+      }
+      SECTION("2 threads") {
+        tc2.congruence().max_threads(2);
+      }
+      SECTION("4 threads") {
+        tc2.congruence().max_threads(4);
+      }
+      SECTION("4 threads + resumed") {
+        tc2.congruence().max_threads(4).run_for(std::chrono::milliseconds(10));
+      }
+      REQUIRE(tc2.size() == 10625);
+      REQUIRE(tc2.congruence().finished());
+      REQUIRE(tc2.congruence().complete());
+      REQUIRE(tc2.congruence().compatible());
+      REQUIRE(tc1.size() == 10625);
+      tc1.congruence().standardize(order::shortlex);
+      tc2.congruence().standardize(order::shortlex);
+      REQUIRE(std::vector<word_type>(tc1.congruence().cbegin_normal_forms(),
+                                     tc1.congruence().cend_normal_forms())
+              == std::vector<word_type>(tc2.congruence().cbegin_normal_forms(),
+                                        tc2.congruence().cend_normal_forms()));
+    }
+
+    LIBSEMIGROUPS_TEST_CASE("ToddCoxeter",
+                            "105",
+                            "corrupt and truncated checkpoints",
+                            "[quick][todd-coxeter]") {
+      auto              rg   = ReportGuard(REPORT);
+      std::string const file = "test-todd-coxeter-105.tmp";
+      auto              init = [](ToddCoxeter& tc) {
+        tc.set_alphabet("ab");
+        tc.add_rule("aaaaa", "a");
+        tc.add_rule("bbbbbb", "b");
+        tc.add_rule("ab", "ba");
+      };
+      ToddCoxeter tc1;
+      init(tc1);
+      tc1.congruence().strategy(policy::strategy::hlt);
+      tc1.congruence().run_until([&tc1]() -> bool {
+        return tc1.congruence().nr_cosets_active() > 10;
+      });
+      REQUIRE(!tc1.congruence().finished());
+      tc1.congruence().save_checkpoint(file);
+
+      std::ifstream     is(file, std::ios::binary);
+      std::string const bytes((std::istreambuf_iterator<char>(is)),
+                              std::istreambuf_iterator<char>());
+      is.close();
+      REQUIRE(!bytes.empty());
+
+      // Returns false if loading data throws a LibsemigroupsException.
+      auto load = [&file, &init](std::string const& data, bool run) -> bool {
+        std::ofstream os(file, std::ios::binary | std::ios::trunc);
+        os.write(data.data(), data.size());
+        os.close();
+        ToddCoxeter tc2;
+        init(tc2);
+        try {
+          tc2.congruence().load_checkpoint(file);
+        } catch (LibsemigroupsException const&) {
+          return false;
+        }
+        if (run) {
+          tc2.congruence().run_for(std::chrono::milliseconds(1));
+        }
+        return true;
+      };
+      REQUIRE(load(bytes, true));
+
+      // Replaces the checksum at the end of data by that of the other bytes.
+      auto rehash = [](std::string data) -> std::string {
+        size_t const       n = data.size() - sizeof(uint64_t);
+        std::istringstream iss(data);
+        uint64_t const     h = detail::checksum(iss, n);
+        std::memcpy(&data[n], &h, sizeof(uint64_t));
+        return data;
+      };
+      REQUIRE(rehash(bytes) == bytes);
+
+      // Every byte is overwritten in turn by several values, and every proper
+      // prefix of the file is tried; all of these are rejected by the
+      // checksum. If the checksum is recomputed, then loading must not read
+      // out of bounds, but the file may be loaded, since the relations in it
+      // are not compared with those of this, and so it is not run.
+      for (size_t i = 0; i < bytes.size(); ++i) {
+        for (char val : {'\x00', '\x01', '\x02', '\x7f', '\xff'}) {
+          std::string corrupt = bytes;
+          corrupt[i]          = val;
+          REQUIRE(load(corrupt, true) == (corrupt == bytes));
+          if (i < bytes.size() - sizeof(uint64_t)) {
+            load(rehash(corrupt), false);
+          }
+        }
+        REQUIRE(!load(bytes.substr(0, i), true));
+      }
+      std::remove(file.c_str());
+    }
   }  // namespace fpsemigroup
 }  // namespace libsemigroups